@@ -0,0 +1,6 @@
+#version 330 core
+
+// Used by the depth pre-pass in place of the material fragment shader (see "ForwardRenderer::drawCommands")
+// Only the depth of the fragments is written, so there is nothing to compute here
+void main(){
+}
@@ -9,6 +9,9 @@ out Varyings {
     vec2 tex_coord;
 } vs_out;
 
+// Needed by the depth pre-pass (see DEPTH_ONLY_FRAGMENT_SHADER)
+invariant gl_Position;
+
 uniform mat4 transform;
 
 void main(){
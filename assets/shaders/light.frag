@@ -5,30 +5,77 @@
 #define SPOT        2
 
 struct Light {
-    int type;
     vec3 position;
+    int type;
     vec3 direction;
     vec3 color;
     vec3 attenuation;
-    vec2 cone_angles;
+    vec2 cone_cosines; // The cosines of the inner and outer cone angles (precomputed by the renderer)
 };
 
-#define MAX_LIGHTS 8
-
-uniform Light lights[MAX_LIGHTS];
-uniform int light_count;
-
-struct Sky {
-    vec3 top, horizon, bottom;
-};
-
-uniform Sky sky;
+// The lights are assigned to a grid of clusters by the renderer (see "LightClusters" in light-clusters.hpp)
+#define CLUSTER_COUNT_X 16
+#define CLUSTER_COUNT_Y 9
+#define CLUSTER_COUNT_Z 24
+#define LIGHT_DATA_TEXELS 4
+// The BAKED_LIGHTING variant reads the light baked in the vertex colors as RGBM (see "LightBaker" in light-baker.hpp)
+#define BAKED_LIGHT_RANGE 8.0
+
+// The renderer compiles a variant of this shader for the lights of the frame (see "LightClusters::getShaderDefines"):
+// DIRECTIONAL_LIGHT_COUNT is the number of directional lights (so their loop has a constant count and can be unrolled),
+// BAKED_LIGHT_COUNT is the number of them (at the start) that the BAKED_LIGHTING variant already has in its vertex colors
+// and POINT_LIGHTS / SPOT_LIGHTS are only defined if a light of that type was assigned to the clusters.
+// Without these defines, the shader handles any number of lights of each type
+#ifndef DIRECTIONAL_LIGHT_COUNT
+#define DIRECTIONAL_LIGHT_COUNT directional_light_count
+#define BAKED_LIGHT_COUNT 0
+#define POINT_LIGHTS
+#define SPOT_LIGHTS
+#endif
+
+// The per-frame data is written once per frame by the renderer (see "FrameBlock" in uniform-buffer.hpp)
+FRAME_BLOCK
+
+// Every light takes LIGHT_DATA_TEXELS texels: (position, type), (direction, inner cone cosine), (color, outer cone cosine), (attenuation, 0)
+// The directional lights come first, followed by the other lights that reach every fragment
+uniform samplerBuffer light_data;
+// The offset, point light count and spot light count of every cluster in "cluster_lights"
+// (the point lights of a cluster are listed before its spot lights)
+uniform usamplerBuffer cluster_grid;
+// The light indices of all the clusters
+uniform usamplerBuffer cluster_lights;
+
+Light fetch_light(int index){
+    int base = index * LIGHT_DATA_TEXELS;
+    vec4 texel0 = texelFetch(light_data, base);
+    vec4 texel1 = texelFetch(light_data, base + 1);
+    vec4 texel2 = texelFetch(light_data, base + 2);
+    vec4 texel3 = texelFetch(light_data, base + 3);
+    return Light(texel0.xyz, int(texel0.w), texel1.xyz, texel2.xyz, texel3.xyz, vec2(texel1.w, texel2.w));
+}
 
 vec3 compute_sky_light(vec3 normal){
     vec3 extreme = normal.y > 0 ? sky.top : sky.bottom;
     return mix(sky.horizon, extreme, normal.y * normal.y);
 }
 
+#ifdef DEFERRED_LIGHTING
+// The deferred lighting pass is a fullscreen triangle (see "fullscreen.vert") that reads the surface from the G-buffer
+// which was written by the GBUFFER variant of this shader (see "DeferredRenderer")
+struct GBuffer {
+    sampler2D albedo;   // albedo, ambient occlusion
+    sampler2D normal;   // world normal
+    sampler2D specular; // specular, roughness
+    sampler2D emissive; // emissive
+    sampler2D depth;
+};
+
+uniform GBuffer gbuffer;
+// Used to get the world position of a pixel back from its depth
+uniform mat4 inverse_VP;
+
+in vec2 tex_coord;
+#else
 struct Material {
     sampler2D albedo;
     sampler2D specular;
@@ -46,8 +93,17 @@ in Varyings {
     vec3 view;
     vec3 world;
 } fs_in;
-
+#endif
+
+#ifdef GBUFFER
+// The G-buffer pass only stores the surface, the lighting is computed later by the DEFERRED_LIGHTING variant
+layout(location = 0) out vec4 gbuffer_albedo;
+layout(location = 1) out vec4 gbuffer_normal;
+layout(location = 2) out vec4 gbuffer_specular;
+layout(location = 3) out vec4 gbuffer_emissive;
+#else
 out vec4 frag_color;
+#endif
 
 float lambert(vec3 normal, vec3 world_to_light_direction) {
     return max(0.0, dot(normal, world_to_light_direction));
@@ -57,50 +113,129 @@ float phong(vec3 reflected, vec3 view, float shininess) {
     return pow(max(0.0, dot(reflected, view)), shininess);
 }
 
+// The lighting of a surface by a light coming from "world_to_light_dir"
+vec3 shade(Light light, vec3 world_to_light_dir, float attenuation, vec3 normal, vec3 view, vec3 diffuse, vec3 specular, float shininess) {
+    vec3 computed_diffuse = light.color * diffuse * lambert(normal, world_to_light_dir);
+
+    vec3 reflected = reflect(-world_to_light_dir, normal);
+    vec3 computed_specular = light.color * specular * phong(reflected, view, shininess);
+
+    return (computed_diffuse + computed_specular) * attenuation;
+}
+
+vec3 compute_directional_light(Light light, vec3 normal, vec3 view, vec3 diffuse, vec3 specular, float shininess) {
+    return shade(light, -light.direction, 1.0, normal, view, diffuse, specular, shininess);
+}
+
+vec3 compute_point_light(Light light, vec3 world, vec3 normal, vec3 view, vec3 diffuse, vec3 specular, float shininess) {
+    vec3 world_to_light_dir = light.position - world;
+    float d = length(world_to_light_dir);
+    world_to_light_dir /= d;
+    float attenuation = 1.0 / dot(light.attenuation, vec3(d*d, d, 1.0));
+    return shade(light, world_to_light_dir, attenuation, normal, view, diffuse, specular, shininess);
+}
+
+vec3 compute_spot_light(Light light, vec3 world, vec3 normal, vec3 view, vec3 diffuse, vec3 specular, float shininess) {
+    vec3 world_to_light_dir = light.position - world;
+    float d = length(world_to_light_dir);
+    world_to_light_dir /= d;
+    float attenuation = 1.0 / dot(light.attenuation, vec3(d*d, d, 1.0));
+    // The cone is compared in cosines so there is no need for an acos per fragment
+    attenuation *= smoothstep(light.cone_cosines.y, light.cone_cosines.x, dot(light.direction, -world_to_light_dir));
+    return shade(light, world_to_light_dir, attenuation, normal, view, diffuse, specular, shininess);
+}
+
+vec3 compute_light(Light light, vec3 world, vec3 normal, vec3 view, vec3 diffuse, vec3 specular, float shininess) {
+    if(light.type == DIRECTIONAL) return compute_directional_light(light, normal, view, diffuse, specular, shininess);
+    if(light.type == SPOT) return compute_spot_light(light, world, normal, view, diffuse, specular, shininess);
+    return compute_point_light(light, world, normal, view, diffuse, specular, shininess);
+}
+
 void main() {
+#ifdef DEFERRED_LIGHTING
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float fragment_depth = texelFetch(gbuffer.depth, pixel, 0).r;
+    // Nothing was drawn on this pixel so the target keeps its clear color (and the sky is drawn there later)
+    if(fragment_depth == 1.0) discard;
+    // The depth is copied to the target so that the forward passes after this one are depth tested against the G-buffer
+    gl_FragDepth = fragment_depth;
+    vec4 world_position = inverse_VP * vec4(vec3(tex_coord, fragment_depth) * 2.0 - 1.0, 1.0);
+    vec3 world = world_position.xyz / world_position.w;
+    vec3 normal = normalize(texelFetch(gbuffer.normal, pixel, 0).xyz);
+    vec3 view = normalize(camera_position - world);
+
+    vec4 albedo_occlusion = texelFetch(gbuffer.albedo, pixel, 0);
+    vec4 specular_roughness = texelFetch(gbuffer.specular, pixel, 0);
+    vec3 diffuse = albedo_occlusion.rgb;
+    vec3 specular = specular_roughness.rgb;
+    float roughness = specular_roughness.a;
+    float occlusion = albedo_occlusion.a;
+    vec3 emissive = texelFetch(gbuffer.emissive, pixel, 0).rgb;
+#else
+    vec3 world = fs_in.world;
     vec3 normal = normalize(fs_in.normal);
     vec3 view = normalize(fs_in.view);
-    
-    vec3 ambient_light = compute_sky_light(normal);
 
     vec3 diffuse = texture(material.albedo, fs_in.tex_coord).rgb;
     vec3 specular = texture(material.specular, fs_in.tex_coord).rgb;
     float roughness = texture(material.roughness, fs_in.tex_coord).r;
-    vec3 ambient = diffuse * texture(material.ambient_occlusion, fs_in.tex_coord).r;
+    float occlusion = texture(material.ambient_occlusion, fs_in.tex_coord).r;
     vec3 emissive = texture(material.emissive, fs_in.tex_coord).rgb;
+#endif
+
+#ifdef GBUFFER
+    gbuffer_albedo = vec4(diffuse, occlusion);
+    gbuffer_normal = vec4(normal, 0.0);
+    gbuffer_specular = vec4(specular, roughness);
+    gbuffer_emissive = vec4(emissive, 1.0);
+#else
+    vec3 ambient_light = compute_sky_light(normal);
+    vec3 ambient = diffuse * occlusion;
 
     float shininess = 2.0 / pow(clamp(roughness, 0.001, 0.999), 4.0) - 2.0;
     
-    vec3 world_to_light_dir;
     vec3 color = emissive + ambient_light * ambient;
-
-    for(int light_idx = 0; light_idx < min(MAX_LIGHTS, light_count); light_idx++){
-        Light light = lights[light_idx];
-        float attenuation = 1.0;
-        if(light.type == DIRECTIONAL){
-            world_to_light_dir = -light.direction;
-        } else {
-            world_to_light_dir = light.position - fs_in.world;
-            float d = length(world_to_light_dir);
-            world_to_light_dir /= d;
-
-            attenuation = 1.0 / dot(light.attenuation, vec3(d*d, d, 1.0));
-
-            if(light.type == SPOT){
-                float angle = acos(dot(light.direction, -world_to_light_dir));
-                attenuation *= smoothstep(light.cone_angles.y, light.cone_angles.x, angle);
-            }
-        }
-
-        vec3 computed_diffuse = light.color * diffuse * lambert(normal, world_to_light_dir);
-
-        vec3 reflected = reflect(-world_to_light_dir, normal);
-        vec3 computed_specular = light.color * specular * phong(reflected, view, shininess);
-
-        color += (computed_diffuse + computed_specular) * attenuation;
-
+    // The global lights reach every fragment
+    // The baked directional lights come first, so the BAKED_LIGHTING variant replaces their loop iterations (except for the
+    // specular which depends on the view) with the diffuse light stored in the vertex colors
+#ifdef BAKED_LIGHTING
+    color += diffuse * fs_in.color.rgb * (fs_in.color.a * BAKED_LIGHT_RANGE);
+    for(int light_idx = 0; light_idx < BAKED_LIGHT_COUNT; light_idx++){
+        Light light = fetch_light(light_idx);
+        vec3 reflected = reflect(light.direction, normal);
+        color += light.color * specular * phong(reflected, view, shininess);
+    }
+    for(int light_idx = BAKED_LIGHT_COUNT; light_idx < DIRECTIONAL_LIGHT_COUNT; light_idx++)
+#else
+    for(int light_idx = 0; light_idx < DIRECTIONAL_LIGHT_COUNT; light_idx++)
+#endif
+        color += compute_directional_light(fetch_light(light_idx), normal, view, diffuse, specular, shininess);
+    // The global lights that are not directional (the lights that never fade out) are rare so they are handled generically
+    for(int light_idx = directional_light_count; light_idx < global_light_count; light_idx++)
+        color += compute_light(fetch_light(light_idx), world, normal, view, diffuse, specular, shininess);
+
+    // The other lights are only the ones assigned to the cluster of this fragment
+    float depth = dot(world - camera_position, camera_forward);
+    ivec3 cluster = ivec3(
+        ivec2(gl_FragCoord.xy / cluster_tile_size),
+        int(floor(log(max(depth, 1e-4)) * cluster_z_scale + cluster_z_bias))
+    );
+    cluster = clamp(cluster, ivec3(0), ivec3(CLUSTER_COUNT_X - 1, CLUSTER_COUNT_Y - 1, CLUSTER_COUNT_Z - 1));
+    uvec3 cluster_range = texelFetch(cluster_grid, (cluster.z * CLUSTER_COUNT_Y + cluster.y) * CLUSTER_COUNT_X + cluster.x).xyz;
+#ifdef POINT_LIGHTS
+    for(uint index = 0u; index < cluster_range.y; index++){
+        int light_idx = int(texelFetch(cluster_lights, int(cluster_range.x + index)).r);
+        color += compute_point_light(fetch_light(light_idx), world, normal, view, diffuse, specular, shininess);
     }
+#endif
+#ifdef SPOT_LIGHTS
+    for(uint index = cluster_range.y; index < cluster_range.y + cluster_range.z; index++){
+        int light_idx = int(texelFetch(cluster_lights, int(cluster_range.x + index)).r);
+        color += compute_spot_light(fetch_light(light_idx), world, normal, view, diffuse, specular, shininess);
+    }
+#endif
     
     frag_color = vec4(color, 1.0);
     // frag_color = vec4(fs_in.normal, 1.0);
-}
\ No newline at end of file
+#endif
+}
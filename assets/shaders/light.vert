@@ -5,10 +5,20 @@ layout(location = 1) in vec4 color;
 layout(location = 2) in vec2 tex_coord;
 layout(location = 3) in vec3 normal;
 
-uniform mat4 VP;
-uniform vec3 camera_position;
+// The per-frame data is written once per frame by the renderer (see "FrameBlock" in uniform-buffer.hpp)
+FRAME_BLOCK
+
+#ifdef INSTANCED
+// Instanced draws read the model matrices of every instance from the instance buffer (see "ForwardRenderer::drawCommands")
+layout(location = 4) in mat4 instance_M;
+layout(location = 8) in mat4 instance_M_IT;
+#define M instance_M
+#define M_IT instance_M_IT
+#else
+// Only the model matrices change from one draw to the next
 uniform mat4 M;
 uniform mat4 M_IT;
+#endif
 
 out Varyings {
     vec4 color;
@@ -18,6 +28,9 @@ out Varyings {
     vec3 world;
 } vs_out;
 
+// Needed by the depth pre-pass (see DEPTH_ONLY_FRAGMENT_SHADER)
+invariant gl_Position;
+
 void main() {
     vec3 world = (M * vec4(position, 1.0)).xyz;
     gl_Position = VP * vec4(world, 1.0);
@@ -0,0 +1,5 @@
+#version 330 core
+
+// The occlusion boxes only need the depth test, nothing is written to the color buffer
+void main(){
+}
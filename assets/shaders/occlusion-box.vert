@@ -0,0 +1,10 @@
+#version 330 core
+
+layout(location = 0) in vec3 position;
+
+// Maps the unit cube to the bounding box of the tested object in clip space
+uniform mat4 transform;
+
+void main(){
+    gl_Position = transform * vec4(position, 1.0);
+}
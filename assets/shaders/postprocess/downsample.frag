@@ -0,0 +1,22 @@
+#version 330
+
+// The texture being downsampled (the previous level of the blur pyramid, see "PostprocessChain")
+uniform sampler2D tex;
+// The size of a texel of "tex" in texture coordinates
+uniform vec2 texel_size;
+
+in vec2 tex_coord;
+out vec4 frag_color;
+
+void main(){
+    // Every output pixel is centered on the corner between 2x2 input texels. Each bilinear tap lands one texel away on another corner
+    // so it averages a 2x2 block, and together they average 4x4 texels which overlap the neighbouring output pixels
+    // (a plain 2x2 average would leave blocky artifacts once the smallest level is upscaled)
+    vec2 offset = texel_size;
+    frag_color = 0.25 * (
+        texture(tex, tex_coord + vec2(-offset.x, -offset.y)) +
+        texture(tex, tex_coord + vec2( offset.x, -offset.y)) +
+        texture(tex, tex_coord + vec2(-offset.x,  offset.y)) +
+        texture(tex, tex_coord + vec2( offset.x,  offset.y))
+    );
+}
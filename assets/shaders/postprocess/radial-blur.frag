@@ -12,12 +12,34 @@ out vec4 frag_color;
 // The strength of the blurring effect
 #define STRENGTH 0.05
 
+#ifdef BLUR_PYRAMID
+// The scene downsampled (and so already blurred) by the blur pyramid of the postprocess chain
+uniform sampler2D blurred;
+// How many scene pixels a texel of "blurred" covers along each axis
+uniform float pyramid_scale;
+// Since every texel of "blurred" is already the average of many scene pixels, a few taps cover the same blur length
+#define PYRAMID_STEPS 4
+#endif
+
 void main(){
     // To apply radial blur, we compute the direction outward from the center to the current pixel
     vec2 step_vector = (tex_coord - 0.5) * (STRENGTH / STEPS);
+#ifdef BLUR_PYRAMID
+    // The taps are spread over the same segment as the full size taps (from 0 to STEPS-1 steps)
+    vec2 pyramid_step = step_vector * (float(STEPS - 1) / PYRAMID_STEPS);
+    vec4 blur = vec4(0.0);
+    for(int i = 0; i < PYRAMID_STEPS; i++){
+        blur += texture(blurred, tex_coord + pyramid_step * (i + 0.5));
+    }
+    blur /= PYRAMID_STEPS;
+    // Near the center the blur is shorter than a texel of "blurred", so it fades to the sharp scene
+    float blur_length = length(step_vector * (STEPS - 1) * vec2(textureSize(tex, 0)));
+    frag_color = mix(texture(tex, tex_coord), blur, clamp(blur_length / pyramid_scale, 0.0, 1.0));
+#else
     // Then we sample multiple pixels along that direction and compute the average
     for(int i = 0; i < STEPS; i++){
         frag_color += texture(tex, tex_coord + step_vector * i);    
     }
     frag_color /= STEPS;
-}
\ No newline at end of file
+#endif
+}
@@ -0,0 +1,86 @@
+#version 330
+
+// The uber postprocess effect combines the vignette, the radial blur of the speed up and the shake and tint of the collision
+// in one pass. Their amounts are the condition weights of the postprocess chain (see "PostprocessChain") which fade in and out,
+// so the effects can overlap and cross-fade without switching programs. The branches depend only on uniforms,
+// so every pixel takes the same path and an effect whose weight is 0 costs nothing
+
+// The texture holding the scene pixels
+uniform sampler2D tex;
+
+// Read "assets/shaders/fullscreen.vert" to know what "tex_coord" holds;
+in vec2 tex_coord;
+out vec4 frag_color;
+
+// The vignette strength, the radial blur amount and the collision amount (from 0 to 1)
+uniform float normal_weight;
+uniform float increase_speed_weight;
+uniform float collision_weight;
+// The elapsed time in seconds (animates the shake)
+uniform float time;
+
+// The number of samples and the strength of the radial blur (as in "radial-blur.frag")
+#define STEPS 16
+#define STRENGTH 0.05
+// The intensity of the shake and the color that the scene is tinted with on collision
+#define SHAKE_INTENSITY 0.003
+#define COLLISION_TINT vec3(1.0, 0.55, 0.55)
+
+#ifdef BLUR_PYRAMID
+// The scene downsampled by the blur pyramid of the postprocess chain (only built while the radial blur is on)
+uniform sampler2D blurred;
+// How many scene pixels a texel of "blurred" covers along each axis
+uniform float pyramid_scale;
+#define PYRAMID_STEPS 4
+#endif
+
+// Function to generate pseudo-random numbers
+float rand(vec2 co){
+    return fract(sin(dot(co.xy ,vec2(12.9898,78.233))) * 43758.5453);
+}
+
+vec4 radial_blur(vec2 coord, float amount){
+    vec2 step_vector = (coord - 0.5) * (STRENGTH * amount / STEPS);
+#ifdef BLUR_PYRAMID
+    vec2 pyramid_step = step_vector * (float(STEPS - 1) / PYRAMID_STEPS);
+    vec4 blur = vec4(0.0);
+    for(int i = 0; i < PYRAMID_STEPS; i++){
+        blur += texture(blurred, coord + pyramid_step * (i + 0.5));
+    }
+    blur /= PYRAMID_STEPS;
+    // Near the center the blur is shorter than a texel of "blurred", so it fades to the sharp scene
+    float blur_length = length(step_vector * (STEPS - 1) * vec2(textureSize(tex, 0)));
+    return mix(texture(tex, coord), blur, clamp(blur_length / pyramid_scale, 0.0, 1.0));
+#else
+    vec4 color = vec4(0.0);
+    for(int i = 0; i < STEPS; i++){
+        color += texture(tex, coord + step_vector * i);
+    }
+    return color / STEPS;
+#endif
+}
+
+void main(){
+    vec2 coord = tex_coord;
+    if(collision_weight > 0.0){
+        // Shake the texture coordinates by a random offset based on time and texture coordinates
+        vec2 random_offset = vec2(rand(tex_coord + time), rand(tex_coord - time)) * 2.0 - 1.0;
+        coord += random_offset * (SHAKE_INTENSITY * collision_weight);
+    }
+
+    if(increase_speed_weight > 0.0){
+        frag_color = radial_blur(coord, increase_speed_weight);
+    } else {
+        frag_color = texture(tex, coord);
+    }
+
+    if(collision_weight > 0.0){
+        frag_color.rgb *= mix(vec3(1.0), COLLISION_TINT, collision_weight);
+    }
+
+    if(normal_weight > 0.0){
+        // Divide the scene color by 1 + the squared distance of the pixel from the center in the NDC space
+        vec2 tex_coord_NDC = 2.0 * tex_coord - 1.0;
+        frag_color /= 1.0 + normal_weight * dot(tex_coord_NDC, tex_coord_NDC);
+    }
+}
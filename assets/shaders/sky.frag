@@ -0,0 +1,11 @@
+#version 330
+
+// The sky cubemap (converted from the equirectangular sky image when the renderer is initialized)
+uniform samplerCube sky;
+
+in vec3 view_direction;
+out vec4 frag_color;
+
+void main(){
+    frag_color = vec4(texture(sky, normalize(view_direction)).rgb, 1.0);
+}
@@ -0,0 +1,24 @@
+#version 330
+
+// The sky is a fullscreen triangle (see "fullscreen.vert") at the far plane, so it is only drawn on the pixels
+// that no opaque object covered and the early depth test rejects the rest before running the fragment shader
+uniform mat4 inverse_VP;
+uniform vec3 camera_position;
+
+// The (unnormalized) world space direction from the camera to the far plane
+out vec3 view_direction;
+
+void main(){
+    vec2 positions[] = vec2[](
+        vec2(-1.0, -1.0),
+        vec2( 3.0, -1.0),
+        vec2(-1.0,  3.0)
+    );
+    vec2 position = positions[gl_VertexID];
+    // z = w puts the triangle exactly on the far plane (depth = 1)
+    gl_Position = vec4(position, 1.0, 1.0);
+    // The homogeneous point is linear over the screen (unlike its projection) so it can be interpolated,
+    // and (point.xyz - camera_position * point.w) has the same direction as (point.xyz / point.w - camera_position)
+    vec4 point = inverse_VP * vec4(position, 1.0, 1.0);
+    view_direction = point.xyz - camera_position * point.w;
+}
@@ -9,11 +9,26 @@ out Varyings {
     vec2 tex_coord;
 } vs_out;
 
+// Needed by the depth pre-pass (see DEPTH_ONLY_FRAGMENT_SHADER)
+invariant gl_Position;
+
+#ifdef INSTANCED
+// Instanced draws read the model matrix of every instance from the instance buffer (see "ForwardRenderer::drawCommands")
+// and the view-projection matrix from the per-frame uniform block
+layout(location = 4) in mat4 instance_M;
+
+FRAME_BLOCK
+#else
 uniform mat4 transform;
+#endif
 
 void main(){
     //TODO: (Req 7) Change the next line to apply the transformation matrix
+#ifdef INSTANCED
+    gl_Position = VP * instance_M * vec4(position, 1.0);
+#else
     gl_Position = transform * vec4(position, 1.0);
+#endif
     vs_out.color = color;
     vs_out.tex_coord = tex_coord;
 }
\ No newline at end of file
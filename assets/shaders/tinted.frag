@@ -4,7 +4,15 @@ in Varyings {
     vec4 color;
 } fs_in;
 
+#ifdef WEIGHTED_BLENDED_OIT
+// The weighted blended OIT variant (see "ForwardRenderer") adds the color weighted by its alpha and depth into two targets:
+// (color * alpha * weight, alpha) where the blending multiplies the alpha by (1 - alpha), and alpha * weight
+layout(location = 0) out vec4 oit_accumulation;
+layout(location = 1) out vec4 oit_weight;
+vec4 frag_color;
+#else
 out vec4 frag_color;
+#endif
 
 uniform vec4 tint;
 
@@ -13,4 +21,9 @@ void main(){
     // by multiplying the tint with the vertex color
 
     frag_color = tint * fs_in.color;
+#ifdef WEIGHTED_BLENDED_OIT
+    float weight = clamp(frag_color.a * max(1e-2, 3e3 * pow(1.0 - gl_FragCoord.z, 3.0)), 1e-2, 3e3);
+    oit_accumulation = vec4(frag_color.rgb * frag_color.a * weight, frag_color.a);
+    oit_weight = vec4(frag_color.a * weight, 0.0, 0.0, 0.0);
+#endif
 }
\ No newline at end of file
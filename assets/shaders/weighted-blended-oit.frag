@@ -0,0 +1,19 @@
+#version 330
+
+// The targets written by the WEIGHTED_BLENDED_OIT variants of the transparent materials (see "ForwardRenderer")
+// accumulation holds (sum of color * alpha * weight, product of (1 - alpha)) and weight holds the sum of alpha * weight
+uniform sampler2D accumulation;
+uniform sampler2D weight;
+
+out vec4 frag_color;
+
+void main(){
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 accumulated = texelFetch(accumulation, pixel, 0);
+    // The alpha is how much of the background is still visible through all the transparent surfaces
+    float revealage = accumulated.a;
+    if(revealage >= 1.0) discard;
+    float total_weight = texelFetch(weight, pixel, 0).r;
+    // The weighted average of the transparent colors is blended over the opaque scene
+    frag_color = vec4(accumulated.rgb / max(total_weight, 1e-5), 1.0 - revealage);
+}
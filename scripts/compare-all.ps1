@@ -159,12 +159,26 @@ $requirement = "renderer-test"
 if( ($tests.Count -eq 0) -or ($tests -contains $requirement)){
     $files = @(
         "test-0.png",
-        "test-1.png"
+        "test-1.png",
+        "test-2.png"
     )
     Write-Output ""
     Write-Output "Comparing $requirement output:"
     & "./scripts/compare-group.ps1" -requirement $requirement -files $files -tolerance 0.04 -threshold 64
     $failure += $LASTEXITCODE
+    # The lit scene is drawn by the forward renderer (test-2) and by the deferred renderer (test-3)
+    # so the deferred output is compared against the forward output of the same run
+    Write-Output "Testing test-3.png against test-2.png ..."
+    & "./scripts/imgcmp" "screenshots/$requirement/test-2.png" "screenshots/$requirement/test-3.png" -o "errors/$requirement/test-3.png" -t 0.04 -e 64
+    if($LASTEXITCODE -ne 0){
+        $failure += 1
+    }
+    # The directional light of test-5 is baked into the static meshes, so it is compared against test-4 where it is realtime
+    Write-Output "Testing test-5.png against test-4.png ..."
+    & "./scripts/imgcmp" "screenshots/$requirement/test-4.png" "screenshots/$requirement/test-5.png" -o "errors/$requirement/test-5.png" -t 0.04 -e 64
+    if($LASTEXITCODE -ne 0){
+        $failure += 1
+    }
 }
 
 ###################################################
@@ -165,7 +165,11 @@ if( ($tests.Count -eq 0) -or ($tests -contains "entity-test")){
 if( ($tests.Count -eq 0) -or ($tests -contains "renderer-test")){
     $configs = @(
         "config/renderer-test/test-0.jsonc",
-        "config/renderer-test/test-1.jsonc"
+        "config/renderer-test/test-1.jsonc",
+        "config/renderer-test/test-2.jsonc",
+        "config/renderer-test/test-3.jsonc",
+        "config/renderer-test/test-4.jsonc",
+        "config/renderer-test/test-5.jsonc"
     )
     Write-Output ""
     Write-Output "Running renderer-test:"
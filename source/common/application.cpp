@@ -24,6 +24,10 @@
 #define ENABLE_OPENGL_DEBUG_MESSAGES
 #endif
 #include "texture/screenshot.hpp"
+#include "systems/gpu-profiler.hpp"
+#include "systems/performance-hud.hpp"
+#include "systems/gl-call-counter.hpp"
+#include "systems/cpu-tracer.hpp"
 
 std::string default_screenshot_filepath() {
     std::stringstream stream;
@@ -35,6 +39,16 @@ std::string default_screenshot_filepath() {
     return stream.str();
 }
 
+std::string default_trace_filepath() {
+    std::stringstream stream;
+    auto time = std::time(nullptr);
+    
+    struct tm localtime;
+    localtime_s(&localtime, &time);
+    stream << "traces/trace-" << std::put_time(&localtime, "%Y-%m-%d-%H-%M-%S") << ".json";
+    return stream.str();
+}
+
 // This function will be used to log errors thrown by GLFW
 void glfw_error_callback(int error, const char* description){
     std::cerr << "GLFW Error: " << error << ": " << description << std::endl;
@@ -174,6 +188,9 @@ void setWindowIcon(GLFWwindow *window, const char *imagePath)
 
 int our::Application::run(int run_for_frames) {
 
+    // The CPU tracer records the scopes of the application (if it is enabled in the config) and is started first to see the whole startup
+    our::CpuTracer::initialize(app_config.value("cpuTracer", nlohmann::json()));
+
     // Set the function to call when an error occurs.
     glfwSetErrorCallback(glfw_error_callback);
 
@@ -220,6 +237,13 @@ int our::Application::run(int run_for_frames) {
     glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 #endif
 
+    // In debug builds, count the OpenGL calls of every frame (this wraps the glad function pointers so it comes right after loading them)
+    our::GLCallCounter::initialize(app_config.value("glCallCounter", nlohmann::json()));
+    // The GPU profiler times the scopes of every frame (if it is enabled in the config)
+    our::GpuProfiler::initialize(app_config.value("gpuProfiler", nlohmann::json()));
+    // The performance HUD is toggled with F3
+    our::PerformanceHud::initialize(app_config.value("performanceHud", nlohmann::json()));
+
     setupCallbacks();
     keyboard.enable(window);
     mouse.enable(window);
@@ -257,7 +281,10 @@ int our::Application::run(int run_for_frames) {
         nextState = nullptr;
     }
     // Call onInitialize if the scene needs to do some custom initialization (such as file loading, object creation, etc).
-    if(currentState) currentState->onInitialize();
+    if(currentState) {
+        TRACE_SCOPE("Initialize state");
+        currentState->onInitialize();
+    }
 
     // The time at which the last frame started. But there was no frames yet, so we'll just pick the current time.
     double last_frame_time = glfwGetTime();
@@ -265,22 +292,31 @@ int our::Application::run(int run_for_frames) {
     //Game loop
     while(!glfwWindowShouldClose(window)){
         if(run_for_frames != 0 && current_frame >= run_for_frames) break;
-        glfwPollEvents(); // Read all the user events and call relevant callbacks.
+        TRACE_SCOPE("Frame");
+        {
+            TRACE_SCOPE("Poll events");
+            glfwPollEvents(); // Read all the user events and call relevant callbacks.
+        }
 
-        // Start a new ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
+        {
+            TRACE_SCOPE("Immediate GUI");
+            // Start a new ImGui frame
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
 
-        if(currentState) currentState->onImmediateGui(); // Call to run any required Immediate GUI.
+            if(currentState) currentState->onImmediateGui(); // Call to run any required Immediate GUI.
+            if(our::GpuProfiler::isPanelEnabled()) our::GpuProfiler::drawPanel();
+            our::PerformanceHud::draw();
 
-        // If ImGui is using the mouse or keyboard, then we don't want the captured events to affect our keyboard and mouse objects.
-        // For example, if you're focusing on an input and writing "W", the keyboard object shouldn't record this event.
-        keyboard.setEnabled(!io.WantCaptureKeyboard, window);
-        mouse.setEnabled(!io.WantCaptureMouse, window);
+            // If ImGui is using the mouse or keyboard, then we don't want the captured events to affect our keyboard and mouse objects.
+            // For example, if you're focusing on an input and writing "W", the keyboard object shouldn't record this event.
+            keyboard.setEnabled(!io.WantCaptureKeyboard, window);
+            mouse.setEnabled(!io.WantCaptureMouse, window);
 
-        // Render the ImGui commands we called (this doesn't actually draw to the screen yet.
-        ImGui::Render();
+            // Render the ImGui commands we called (this doesn't actually draw to the screen yet.
+            ImGui::Render();
+        }
 
         // Just in case ImGui changed the OpenGL viewport (the portion of the window to which we render the geometry),
         // we set it back to cover the whole window
@@ -290,8 +326,13 @@ int our::Application::run(int run_for_frames) {
         // Get the current time (the time at which we are starting the current frame).
         double current_frame_time = glfwGetTime();
 
+        our::GpuProfiler::beginFrame();
+        our::PerformanceHud::recordFrameTime((float)(current_frame_time - last_frame_time) * 1000.0f);
         // Call onDraw, in which we will draw the current frame, and send to it the time difference between the last and current frame
-        if(currentState) currentState->onDraw(current_frame_time - last_frame_time);
+        if(currentState) {
+            TRACE_SCOPE("Draw");
+            currentState->onDraw(current_frame_time - last_frame_time);
+        }
         last_frame_time = current_frame_time; // Then update the last frame start time (this frame is now the last frame)
 
 #if defined(ENABLE_OPENGL_DEBUG_MESSAGES)
@@ -299,12 +340,33 @@ int our::Application::run(int run_for_frames) {
         glDisable(GL_DEBUG_OUTPUT);
         glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 #endif
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // Render the ImGui to the framebuffer
+        {
+            TRACE_SCOPE("Render ImGui");
+            our::GpuProfiler::beginScope("ImGui");
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // Render the ImGui to the framebuffer
+            our::GpuProfiler::endScope();
+        }
 #if defined(ENABLE_OPENGL_DEBUG_MESSAGES)
         // Re-enable the debug messages
         glEnable(GL_DEBUG_OUTPUT);
         glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 #endif
+        our::GpuProfiler::endFrame();
+        our::PerformanceHud::endFrame();
+        our::GLCallCounter::endFrame();
+
+        // If F3 is pressed, show or hide the performance HUD
+        if(keyboard.justPressed(GLFW_KEY_F3)) our::PerformanceHud::toggle();
+
+        // If F9 is pressed, save the CPU trace recorded so far
+        if(keyboard.justPressed(GLFW_KEY_F9) && our::CpuTracer::isEnabled()){
+            std::string path = default_trace_filepath();
+            if(our::CpuTracer::dump(path)){
+                std::cout << "CPU trace saved to: " << path << std::endl;
+            } else {
+                std::cerr << "Failed to save the CPU trace" << std::endl;
+            }
+        }
 
         // If F12 is pressed, take a screenshot
         if(keyboard.justPressed(GLFW_KEY_F12)){
@@ -329,7 +391,10 @@ int our::Application::run(int run_for_frames) {
         }
 
         // Swap the frame buffers
-        glfwSwapBuffers(window);
+        {
+            TRACE_SCOPE("Swap buffers");
+            glfwSwapBuffers(window);
+        }
 
         // Update the keyboard and mouse data
         keyboard.update();
@@ -337,6 +402,7 @@ int our::Application::run(int run_for_frames) {
 
         // If a scene change was requested, apply it
         while(nextState){
+            TRACE_SCOPE("Change state");
             // If a scene was already running, destroy it (not delete since we can go back to it later)
             if(currentState) currentState->onDestroy();
             // Switch scenes
@@ -351,6 +417,9 @@ int our::Application::run(int run_for_frames) {
 
     // Call for cleaning up
     if(currentState) currentState->onDestroy();
+    our::GpuProfiler::destroy();
+    our::GLCallCounter::destroy();
+    our::CpuTracer::destroy();
 
     // Shutdown ImGui & destroy the context
     ImGui_ImplOpenGL3_Shutdown();
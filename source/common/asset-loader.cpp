@@ -8,6 +8,7 @@
 #include "mesh/mesh-utils.hpp"
 #include "material/material.hpp"
 #include "deserialize-utils.hpp"
+#include "systems/cpu-tracer.hpp"
 
 namespace our {
 
@@ -18,6 +19,7 @@ namespace our {
     void AssetLoader<ShaderProgram>::deserialize(const nlohmann::json& data) {
         if(data.is_object()){
             for(auto& [name, desc] : data.items()){
+                TRACE_SCOPE_ARGUMENT("Load shader", name.c_str());
                 std::string vsPath = desc.value("vs", "");
                 std::string fsPath = desc.value("fs", "");
                 auto shader = new ShaderProgram();
@@ -36,6 +38,7 @@ namespace our {
     void AssetLoader<Texture2D>::deserialize(const nlohmann::json& data) {
         if(data.is_object()){
             for(auto& [name, desc] : data.items()){
+                TRACE_SCOPE_ARGUMENT("Load texture", name.c_str());
                 std::string path = desc.get<std::string>();
                 assets[name] = texture_utils::loadImage(path);
             }
@@ -67,6 +70,7 @@ namespace our {
     void AssetLoader<Mesh>::deserialize(const nlohmann::json& data) {
         if(data.is_object()){
             for(auto& [name, desc] : data.items()){
+                TRACE_SCOPE_ARGUMENT("Load mesh", name.c_str());
                 std::string path = desc.get<std::string>();
                 assets[name] = mesh_utils::loadOBJ(path);
             }
@@ -99,6 +103,7 @@ namespace our {
 
     void deserializeAllAssets(const nlohmann::json& assetData){
         if(!assetData.is_object()) return;
+        TRACE_SCOPE("Load assets");
         if(assetData.contains("shaders"))
             AssetLoader<ShaderProgram>::deserialize(assetData["shaders"]);
         if(assetData.contains("textures"))
@@ -32,6 +32,15 @@ namespace our {
             }
             return nullptr;
         };
+        // This function adds an asset that was created at runtime (e.g. a static batch mesh) under the given name
+        // The asset loader takes the ownership of the asset (if an asset with the same name exists, it is deleted)
+        static void add(const std::string& name, T* asset) {
+            if(auto it = assets.find(name); it != assets.end() && it->second != asset)
+                delete it->second;
+            assets[name] = asset;
+        }
+        // Returns all the loaded assets (by name)
+        static const std::unordered_map<std::string, T*>& getAll() { return assets; }
         // This function deletes all the assets held by this class and clear the assets map 
         static void clear(){
             for(auto& [name, asset] : assets){
@@ -32,6 +32,9 @@ namespace our
 
         // Read the "displacement" value from the JSON object or use the default value from the member variable
         displacement = data.value("displacement", 0.0f);
+
+        // Read the "bake" value from the JSON object or use the default value from the member variable
+        bake = data.value("bake", bake);
         
     
     }
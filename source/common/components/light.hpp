@@ -18,6 +18,8 @@ namespace our
         glm::vec3 attenuation; // Attenuation factors for the light (controls falloff)
         glm::vec2 cone_angles; // Cone angles for spot lighting (inner and outer angles)
         float displacement;    // Displacement of the light (for point light)
+        bool bake = false;     // If true, the light is baked into the meshes that never rotate (see "LightBaker") instead of being computed for them every frame
+        bool baked = false;    // Set by the light baker once the light is baked, the baked meshes skip it but every other mesh still computes it
         
         #define DIRECTIONAL 0
         #define POINT       1
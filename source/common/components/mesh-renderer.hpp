@@ -4,14 +4,26 @@
 #include "../mesh/mesh.hpp"
 #include "../material/material.hpp"
 #include "../asset-loader.hpp"
+#include <unordered_set>
+#include <cstdint>
 
 namespace our {
 
     // This component denotes that any renderer should draw the given mesh using the given material at the transformation of the owning entity.
     class MeshRendererComponent : public Component {
     public:
-        Mesh* mesh; // The mesh that should be drawn
-        Material* material; // The material used to draw the mesh
+        Mesh* mesh = nullptr; // The mesh that should be drawn
+        Material* material = nullptr; // The material used to draw the mesh
+        // If true, the vertex colors of the mesh hold the light baked by the "LightBaker" (so it is drawn with the BAKED_LIGHTING variant)
+        bool bakedLighting = false;
+
+        // Every mesh renderer that currently exists. The renderer keeps a command for each of them between frames,
+        // and "instancesVersion" changes whenever a mesh renderer is created or deleted so that it knows when to update its list
+        static inline std::unordered_set<MeshRendererComponent*> instances;
+        static inline std::uint64_t instancesVersion = 0;
+
+        MeshRendererComponent() { instances.insert(this); instancesVersion++; }
+        ~MeshRendererComponent() override { instances.erase(this); instancesVersion++; }
 
         // The ID of this component type is "Mesh Renderer"
         static std::string getID() { return "Mesh Renderer"; }
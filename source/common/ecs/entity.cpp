@@ -32,6 +32,8 @@ namespace our
             return;
         name = data.value("name", name);
         size = data.value("size", size);
+        isStatic = data.value("static", isStatic);
+        isTranslationOnly = data.value("translationOnly", isTranslationOnly);
         localTransform.deserialize(data);
 
         if (data.contains("components"))
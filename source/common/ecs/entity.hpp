@@ -23,8 +23,11 @@ namespace our {
                           // If parent is null, the entity is a root entity (has no parent).
         Transform localTransform; // The transform of this entity relative to its parent.
         bool hidden=false;
+        bool isStatic=false; // If true, the entity never moves relative to its parent so its mesh can be merged into a static batch
+        bool isTranslationOnly=false; // If true, the entity may move but its rotation and scale never change (so the directional lights can be baked into it)
         float size = 0 ;
         World *getWorld() const { return world; } // Returns the world to which this entity belongs
+        size_t getComponentCount() const { return components.size(); } // Returns the number of components of this entity
 
         glm::mat4 getLocalToWorldMatrix() const; // Computes and returns the transformation from the entities local space to the world space
         void deserialize(const nlohmann::json&); // Deserializes the entity data and components from a json object
@@ -7,10 +7,12 @@ namespace our
 {
 
     // This function should setup the pipeline state and set the shader to be used
-    void Material::setup() const
+    // If "program" is given (e.g. a variant of the material shader), it is used instead of the material shader
+    void Material::setup(ShaderProgram* program) const
     {
+        if(!program) program = shader;
         // TODO: (Req 7) Write this function
-        shader->use();
+        program->use();
         pipelineState.setup();
     }
 
@@ -30,13 +32,14 @@ namespace our
 
     // This function should call the setup of its parent and
     // set the "tint" uniform to the value in the member variable tint
-    void TintedMaterial::setup() const
+    void TintedMaterial::setup(ShaderProgram* program) const
     {
+        if(!program) program = shader;
         // TODO: (Req 7) Write this function
         //  Call the setup of its parent
-        Material::setup();
+        Material::setup(program);
         // Set the "tint" uniform
-        shader->set("tint", tint);
+        program->set("tint", tint);
     }
 
     // This function read the material data from a json object
@@ -51,20 +54,21 @@ namespace our
     // This function should call the setup of its parent and
     // set the "alphaThreshold" uniform to the value in the member variable alphaThreshold
     // Then it should bind the texture and sampler to a texture unit and send the unit number to the uniform variable "tex"
-    void TexturedMaterial::setup() const
+    void TexturedMaterial::setup(ShaderProgram* program) const
     {
+        if(!program) program = shader;
         // TODO: (Req 7) Write this function
         //  Call the setup of its parent
-        TintedMaterial::setup();
+        TintedMaterial::setup(program);
         // Set the "alphaThreshold" uniform
-        shader->set("alphaThreshold", alphaThreshold);
+        program->set("alphaThreshold", alphaThreshold);
         // Bind the texture and sampler to a texture unit
         glActiveTexture(GL_TEXTURE0);
         texture->bind();    
         if(sampler)        
         sampler->bind(0);
         // Send the unit number to the uniform variable "tex"
-        shader->set("tex",0);
+        program->set("tex",0);
     }
 
     // This function read the material data from a json object
@@ -77,16 +81,17 @@ namespace our
         texture = AssetLoader<Texture2D>::get(data.value("texture", ""));
         sampler = AssetLoader<Sampler>::get(data.value("sampler", ""));
     }
-    void LightingMaterial::setup() const
+    void LightingMaterial::setup(ShaderProgram* program) const
     {
-        TintedMaterial::setup();
+        if(!program) program = shader;
+        TintedMaterial::setup(program);
         //albedo
         if(albedo!=nullptr)
         {
         glActiveTexture(GL_TEXTURE0);
         albedo->bind();
         sampler->bind(0);
-        shader->set("material.albedo", 0);
+        program->set("material.albedo", 0);
         }
         //specular
         if(specular!=nullptr)
@@ -94,7 +99,7 @@ namespace our
         glActiveTexture(GL_TEXTURE1);
         specular->bind();
         sampler->bind(1);
-        shader->set("material.specular", 1);
+        program->set("material.specular", 1);
         }
         if(emissive!=nullptr)
         {
@@ -102,7 +107,7 @@ namespace our
         glActiveTexture(GL_TEXTURE2);
         emissive->bind();
         sampler->bind(2);
-        shader->set("material.emissive", 2);
+        program->set("material.emissive", 2);
         }
         if(roughness!=nullptr)
         {
@@ -110,7 +115,7 @@ namespace our
         glActiveTexture(GL_TEXTURE3);
         roughness->bind();
         sampler->bind(3);
-        shader->set("material.roughness", 3);
+        program->set("material.roughness", 3);
         }
         if(ambient_occlusion!=nullptr)
         {
@@ -118,7 +123,7 @@ namespace our
         glActiveTexture(GL_TEXTURE4);
         ambient_occlusion->bind();
         sampler->bind(4);
-        shader->set("material.ambient_occlusion", 4);
+        program->set("material.ambient_occlusion", 4);
         }
     }
     void LightingMaterial::deserialize(const nlohmann::json &data)
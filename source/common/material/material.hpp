@@ -6,6 +6,7 @@
 #include "../shader/shader.hpp"
 
 #include <glm/vec4.hpp>
+#include <cstdint>
 #include <json/json.hpp>
 
 namespace our {
@@ -17,13 +18,19 @@ namespace our {
     // 3- Whether this material is transparent or not
     // Materials that send uniforms to the shader should inherit from the is material and add the required uniforms
     class Material {
+        // Used to give every material a unique id
+        inline static std::uint32_t nextId = 0;
     public:
         PipelineState pipelineState;
         ShaderProgram* shader;
         bool transparent;
+        // A unique id of this material (the renderer uses it to group draws by material)
+        std::uint32_t id = nextId++;
         
         // This function does 2 things: setup the pipeline state and set the shader program to be used
-        virtual void setup() const;
+        // "program" can be used to draw with a variant of the material shader (see "ShaderProgram::getVariant")
+        // instead of the material shader itself, in which case the material uniforms are sent to that variant
+        virtual void setup(ShaderProgram* program = nullptr) const;
         // This function read a material from a json object
         virtual void deserialize(const nlohmann::json& data);
     };
@@ -34,7 +41,7 @@ namespace our {
     public:
         glm::vec4 tint;
 
-        void setup() const override;
+        void setup(ShaderProgram* program = nullptr) const override;
         void deserialize(const nlohmann::json& data) override;
     };
 
@@ -49,7 +56,7 @@ namespace our {
         Sampler* sampler;
         float alphaThreshold;
 
-        void setup() const override;
+        void setup(ShaderProgram* program = nullptr) const override;
         void deserialize(const nlohmann::json& data) override;
     };
      // light material will inherit from the  material and define all texture types for the light material.
@@ -62,7 +69,7 @@ namespace our {
         Texture2D *ambient_occlusion;
         Sampler* sampler;
 
-        void setup() const override;
+        void setup(ShaderProgram* program = nullptr) const override;
         void deserialize(const nlohmann::json& data) override;
     };
 
@@ -3,6 +3,137 @@
 
 namespace our {
 
+    namespace {
+        // This is a shadow of the options currently set in OpenGL, it is only meaningful if "cacheValid" is true
+        PipelineState cachedState;
+        bool cacheValid = false;
+
+        PipelineState::Statistics frameStatistics, lastFrameStatistics;
+
+        // The number of OpenGL calls the uncached setup used to issue for a given state
+        unsigned int fullSetupCalls(const PipelineState &state){
+            return 2 + (state.faceCulling.enabled ? 3 : 1) + (state.depthTesting.enabled ? 2 : 1) + (state.blending.enabled ? 4 : 1);
+        }
+    }
+
+    void PipelineState::setup() const {
+        frameStatistics.setups++;
+        // Most consecutive draws share the same state, so this is the common path
+        // (the states are edited field by field, so they are compared directly instead of through a hash that could go stale)
+        if(cacheValid && *this == cachedState){
+            frameStatistics.skippedSetups++;
+            frameStatistics.savedCalls += fullSetupCalls(*this);
+            return;
+        }
+
+        unsigned int issued = 0;
+        // If the cache is invalid, we don't know anything about the OpenGL state so we apply every option
+        bool force = !cacheValid;
+
+        if(force || colorMask != cachedState.colorMask){
+            glColorMask(colorMask[0], colorMask[1], colorMask[2], colorMask[3]);
+            issued++;
+        }
+        if(force || depthMask != cachedState.depthMask){
+            glDepthMask(depthMask);
+            issued++;
+        }
+
+        // The sub-options of a disabled feature are left untouched (unless we know nothing about them),
+        // so the shadow always holds their actual OpenGL values
+        if(force || faceCulling.enabled != cachedState.faceCulling.enabled){
+            if(faceCulling.enabled) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+            issued++;
+        }
+        if(force || faceCulling.enabled){
+            if(force || faceCulling.culledFace != cachedState.faceCulling.culledFace){
+                glCullFace(faceCulling.culledFace);
+                issued++;
+            }
+            if(force || faceCulling.frontFace != cachedState.faceCulling.frontFace){
+                glFrontFace(faceCulling.frontFace);
+                issued++;
+            }
+            cachedState.faceCulling = faceCulling;
+        } else cachedState.faceCulling.enabled = false;
+
+        if(force || depthTesting.enabled != cachedState.depthTesting.enabled){
+            if(depthTesting.enabled) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
+            issued++;
+        }
+        if(force || depthTesting.enabled){
+            if(force || depthTesting.function != cachedState.depthTesting.function){
+                glDepthFunc(depthTesting.function);
+                issued++;
+            }
+            cachedState.depthTesting = depthTesting;
+        } else cachedState.depthTesting.enabled = false;
+
+        if(force || blending.enabled != cachedState.blending.enabled){
+            if(blending.enabled) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+            issued++;
+        }
+        if(force || blending.enabled){
+            if(force || blending.equation != cachedState.blending.equation){
+                glBlendEquation(blending.equation);
+                issued++;
+            }
+            if(force || blending.sourceFactor != cachedState.blending.sourceFactor || blending.destinationFactor != cachedState.blending.destinationFactor ||
+                blending.separateAlpha != cachedState.blending.separateAlpha || (blending.separateAlpha &&
+                (blending.sourceAlphaFactor != cachedState.blending.sourceAlphaFactor || blending.destinationAlphaFactor != cachedState.blending.destinationAlphaFactor))){
+                if(blending.separateAlpha)
+                    glBlendFuncSeparate(blending.sourceFactor, blending.destinationFactor, blending.sourceAlphaFactor, blending.destinationAlphaFactor);
+                else
+                    glBlendFunc(blending.sourceFactor, blending.destinationFactor);
+                issued++;
+            }
+            if(force || blending.constantColor != cachedState.blending.constantColor){
+                glBlendColor(blending.constantColor[0], blending.constantColor[1], blending.constantColor[2], blending.constantColor[3]);
+                issued++;
+            }
+            cachedState.blending = blending;
+        } else cachedState.blending.enabled = false;
+
+        cachedState.colorMask = colorMask;
+        cachedState.depthMask = depthMask;
+        cacheValid = true;
+
+        frameStatistics.issuedCalls += issued;
+        unsigned int full = fullSetupCalls(*this);
+        if(full > issued) frameStatistics.savedCalls += full - issued;
+    }
+
+    bool PipelineState::operator==(const PipelineState &other) const {
+        return faceCulling.enabled == other.faceCulling.enabled &&
+            faceCulling.culledFace == other.faceCulling.culledFace &&
+            faceCulling.frontFace == other.faceCulling.frontFace &&
+            depthTesting.enabled == other.depthTesting.enabled &&
+            depthTesting.function == other.depthTesting.function &&
+            blending.enabled == other.blending.enabled &&
+            blending.equation == other.blending.equation &&
+            blending.sourceFactor == other.blending.sourceFactor &&
+            blending.destinationFactor == other.blending.destinationFactor &&
+            blending.separateAlpha == other.blending.separateAlpha &&
+            blending.sourceAlphaFactor == other.blending.sourceAlphaFactor &&
+            blending.destinationAlphaFactor == other.blending.destinationAlphaFactor &&
+            blending.constantColor == other.blending.constantColor &&
+            colorMask == other.colorMask &&
+            depthMask == other.depthMask;
+    }
+
+    void PipelineState::invalidateCache(){
+        cacheValid = false;
+    }
+
+    const PipelineState::Statistics &PipelineState::getStatistics(){
+        return lastFrameStatistics;
+    }
+
+    void PipelineState::newFrame(){
+        lastFrameStatistics = frameStatistics;
+        frameStatistics = {};
+    }
+
     // Given a json object, this function deserializes a PipelineState structure
     void PipelineState::deserialize(const nlohmann::json& data){
         // If the given json data does not represent a json object, return
@@ -53,6 +184,19 @@ namespace our {
                 if(auto it = gl_enum_deserialize::blend_functions.find(config.value("destinationFactor","")); 
                 it != gl_enum_deserialize::blend_functions.end())
                     blending.destinationFactor = it->second;
+
+                // The alpha factors are only separate from the color factors if one of them is given
+                if(auto it = gl_enum_deserialize::blend_functions.find(config.value("sourceAlphaFactor",""));
+                it != gl_enum_deserialize::blend_functions.end()){
+                    blending.sourceAlphaFactor = it->second;
+                    blending.separateAlpha = true;
+                }
+
+                if(auto it = gl_enum_deserialize::blend_functions.find(config.value("destinationAlphaFactor",""));
+                it != gl_enum_deserialize::blend_functions.end()){
+                    blending.destinationAlphaFactor = it->second;
+                    blending.separateAlpha = true;
+                }
                 
                 blending.constantColor = config.value("constantColor", blending.constantColor);
             }
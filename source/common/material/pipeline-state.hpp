@@ -34,6 +34,10 @@ namespace our
             GLenum equation = GL_FUNC_ADD;
             GLenum sourceFactor = GL_SRC_ALPHA;
             GLenum destinationFactor = GL_ONE_MINUS_SRC_ALPHA;
+            // If true, the alpha channel is blended with its own factors (check glBlendFuncSeparate)
+            bool separateAlpha = false;
+            GLenum sourceAlphaFactor = GL_ONE;
+            GLenum destinationAlphaFactor = GL_ZERO;
             glm::vec4 constantColor = {0, 0, 0, 0};
         } blending;
 
@@ -44,39 +48,28 @@ namespace our
 
         // This function should set the OpenGL options to the values specified by this structure
         // For example, if faceCulling.enabled is true, you should call glEnable(GL_CULL_FACE), otherwise, you should call glDisable(GL_CULL_FACE)
-        void setup() const
-        {
-            // TODO: (Req 4) Write this function
-            glColorMask(colorMask[0], colorMask[1], colorMask[2], colorMask[3]);
-            glDepthMask(depthMask);
+        // The OpenGL state is shadowed by a cache so only the options that differ from the last applied state are issued
+        void setup() const;
 
-            if (faceCulling.enabled)
-            {
-                glEnable(GL_CULL_FACE);
-                glCullFace(faceCulling.culledFace);
-                glFrontFace(faceCulling.frontFace);
-            }
-            else
-                glDisable(GL_CULL_FACE);
+        bool operator==(const PipelineState &other) const;
+        bool operator!=(const PipelineState &other) const { return !(*this == other); }
 
-            if (depthTesting.enabled)
-            {
-                glEnable(GL_DEPTH_TEST);
-                glDepthFunc(depthTesting.function);
-            }
-            else
-                glDisable(GL_DEPTH_TEST);
+        // Forget the cached OpenGL state. This must be called after changing any of the options above
+        // directly through OpenGL (e.g. forcing the masks before a glClear) so the next setup reapplies everything
+        static void invalidateCache();
 
-            if (blending.enabled)
-            {
-                glEnable(GL_BLEND);
-                glBlendEquation(blending.equation);
-                glBlendFunc(blending.sourceFactor, blending.destinationFactor);
-                glBlendColor(blending.constantColor[0], blending.constantColor[1], blending.constantColor[2], blending.constantColor[3]);
-            }
-            else
-                glDisable(GL_BLEND);
-        }
+        // These counters describe how much work the state cache did
+        struct Statistics
+        {
+            unsigned int setups = 0;        // The number of calls to setup
+            unsigned int skippedSetups = 0; // The number of setups that matched the cached state and issued nothing
+            unsigned int issuedCalls = 0;   // The number of OpenGL calls that were actually issued
+            unsigned int savedCalls = 0;    // The number of OpenGL calls an uncached setup would have issued on top of those
+        };
+        // Returns the statistics of the last completed frame
+        static const Statistics &getStatistics();
+        // Marks the start of a new frame: the counters of the current frame become the last frame statistics
+        static void newFrame();
 
         // Given a json object, this function deserializes a PipelineState structure
         void deserialize(const nlohmann::json &data);
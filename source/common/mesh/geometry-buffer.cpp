@@ -0,0 +1,155 @@
+#include "geometry-buffer.hpp"
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace our {
+
+    size_t RangeAllocator::allocate(size_t size) {
+        if(size == 0) return 0;
+        for(auto it = freeRanges.begin(); it != freeRanges.end(); ++it){
+            auto [offset, rangeSize] = *it;
+            if(rangeSize < size) continue;
+            freeRanges.erase(it);
+            if(rangeSize > size) freeRanges[offset + size] = rangeSize - size;
+            return offset;
+        }
+        return SIZE_MAX;
+    }
+
+    void RangeAllocator::free(size_t offset, size_t size) {
+        if(size == 0) return;
+        auto next = freeRanges.lower_bound(offset);
+        // Merge with the next range if it starts right after this one
+        if(next != freeRanges.end() && next->first == offset + size){
+            size += next->second;
+            next = freeRanges.erase(next);
+        }
+        // Merge with the previous range if it ends right before this one
+        if(next != freeRanges.begin()){
+            auto previous = std::prev(next);
+            if(previous->first + previous->second == offset){
+                previous->second += size;
+                return;
+            }
+        }
+        freeRanges[offset] = size;
+    }
+
+    void RangeAllocator::grow(size_t size) {
+        size_t offset = capacity;
+        capacity += size;
+        free(offset, size);
+    }
+
+    void GeometryBuffer::create() {
+        glGenVertexArrays(1, &vertexArray);
+        glGenBuffers(1, &vertexBuffer);
+        glGenBuffers(1, &elementBuffer);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, INITIAL_VERTEX_CAPACITY * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+        vertexAllocator.grow(INITIAL_VERTEX_CAPACITY);
+
+        glBindVertexArray(vertexArray);
+        // The element buffer binding is stored in the vertex array
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, INITIAL_ELEMENT_CAPACITY * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+        elementAllocator.grow(INITIAL_ELEMENT_CAPACITY);
+        setupAttributes();
+        glBindVertexArray(0);
+        bound = false;
+    }
+
+    void GeometryBuffer::destroy() {
+        glDeleteVertexArrays(1, &vertexArray);
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteBuffers(1, &elementBuffer);
+        vertexArray = vertexBuffer = elementBuffer = 0;
+        vertexAllocator.reset();
+        elementAllocator.reset();
+        bound = false;
+    }
+
+    void GeometryBuffer::setupAttributes() {
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+        //Position attribute
+        glEnableVertexAttribArray(ATTRIB_LOC_POSITION);
+        glVertexAttribPointer(ATTRIB_LOC_POSITION, 3, GL_FLOAT, false, sizeof(Vertex), (void*)offsetof(Vertex, position));
+
+        //Color attribute
+        glEnableVertexAttribArray(ATTRIB_LOC_COLOR);
+        glVertexAttribPointer(ATTRIB_LOC_COLOR, 4, GL_UNSIGNED_BYTE, true, sizeof(Vertex), (void*)offsetof(Vertex, color));
+
+        //TexCoord attribute
+        glEnableVertexAttribArray(ATTRIB_LOC_TEXCOORD);
+        glVertexAttribPointer(ATTRIB_LOC_TEXCOORD, 2, GL_FLOAT, false, sizeof(Vertex), (void*)offsetof(Vertex, tex_coord));
+
+        //Normal attribute
+        glEnableVertexAttribArray(ATTRIB_LOC_NORMAL);
+        glVertexAttribPointer(ATTRIB_LOC_NORMAL, 3, GL_FLOAT, false, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    }
+
+    void GeometryBuffer::growBuffer(GLuint& buffer, size_t oldSize, size_t newSize) {
+        GLuint newBuffer;
+        glGenBuffers(1, &newBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+        buffer = newBuffer;
+    }
+
+    void GeometryBuffer::allocate(const Vertex* vertices, size_t vertexCount, const unsigned int* elements, size_t elementCount,
+        GLint& baseVertex, size_t& firstElement) {
+        if(allocationCount++ == 0) create();
+
+        size_t vertexOffset = vertexAllocator.allocate(vertexCount);
+        if(vertexOffset == SIZE_MAX){
+            // Double the capacity (or more if the mesh is bigger than that) and keep the old content
+            size_t oldCapacity = vertexAllocator.getCapacity();
+            size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + vertexCount);
+            growBuffer(vertexBuffer, oldCapacity * sizeof(Vertex), newCapacity * sizeof(Vertex));
+            vertexAllocator.grow(newCapacity - oldCapacity);
+            // The vertex array references the old vertex buffer so we point its attributes to the new one
+            glBindVertexArray(vertexArray);
+            setupAttributes();
+            vertexOffset = vertexAllocator.allocate(vertexCount);
+        }
+        size_t elementOffset = elementAllocator.allocate(elementCount);
+        if(elementOffset == SIZE_MAX){
+            size_t oldCapacity = elementAllocator.getCapacity();
+            size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + elementCount);
+            growBuffer(elementBuffer, oldCapacity * sizeof(unsigned int), newCapacity * sizeof(unsigned int));
+            elementAllocator.grow(newCapacity - oldCapacity);
+            glBindVertexArray(vertexArray);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+            elementOffset = elementAllocator.allocate(elementCount);
+        }
+        glBindVertexArray(0);
+        bound = false;
+
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * sizeof(Vertex), vertexCount * sizeof(Vertex), vertices);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        // The element buffer is uploaded through the copy target so that we don't have to bind the vertex array
+        glBindBuffer(GL_COPY_WRITE_BUFFER, elementBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, elementOffset * sizeof(unsigned int), elementCount * sizeof(unsigned int), elements);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        baseVertex = (GLint)vertexOffset;
+        firstElement = elementOffset;
+    }
+
+    void GeometryBuffer::free(GLint baseVertex, size_t vertexCount, size_t firstElement, size_t elementCount) {
+        vertexAllocator.free(baseVertex, vertexCount);
+        elementAllocator.free(firstElement, elementCount);
+        if(--allocationCount == 0) destroy();
+    }
+
+}
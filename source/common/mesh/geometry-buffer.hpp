@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <map>
+#include <cstddef>
+#include "vertex.hpp"
+
+namespace our {
+
+    // A first-fit allocator of ranges inside a buffer (in units of elements, not bytes)
+    // Freed ranges are merged with their free neighbours so that the buffer does not fragment over time
+    class RangeAllocator {
+        // The free ranges of the buffer stored as {offset: size}
+        std::map<size_t, size_t> freeRanges;
+        size_t capacity = 0;
+    public:
+        // Allocates "size" elements and returns the offset of the range or SIZE_MAX if there is no free range large enough
+        size_t allocate(size_t size);
+        // Returns a range allocated by "allocate" to the allocator
+        void free(size_t offset, size_t size);
+        // Adds "size" free elements to the end of the buffer (used when the buffer grows)
+        void grow(size_t size);
+        size_t getCapacity() const { return capacity; }
+        void reset() { freeRanges.clear(); capacity = 0; }
+    };
+
+    // The geometry buffer holds the vertices and elements of every mesh in a single vertex buffer and a single element buffer
+    // Since there is only one vertex format ("Vertex"), all the meshes share one vertex array and a mesh is just a range of
+    // the buffers which is drawn using "glDrawElementsBaseVertex", so switching from a mesh to another does not bind anything.
+    // The buffers grow (by copying them into bigger buffers) when they run out of space, and they are deleted when the last mesh is freed
+    class GeometryBuffer {
+        static inline GLuint vertexArray = 0, vertexBuffer = 0, elementBuffer = 0;
+        static inline RangeAllocator vertexAllocator, elementAllocator;
+        // The number of ranges that are currently allocated
+        static inline size_t allocationCount = 0;
+        // Whether the vertex array is known to be bound (see "bind")
+        static inline bool bound = false;
+
+        static void create();
+        static void destroy();
+        // Replaces the buffer with a bigger one that keeps the content of the old one
+        static void growBuffer(GLuint& buffer, size_t oldSize, size_t newSize);
+        // Defines the vertex attributes of the vertex array (which should be bound) from the current vertex buffer
+        static void setupAttributes();
+    public:
+        // The initial capacities of the buffers
+        static constexpr size_t INITIAL_VERTEX_CAPACITY = 1 << 18;
+        static constexpr size_t INITIAL_ELEMENT_CAPACITY = 1 << 20;
+
+        // Copies the vertices and elements into the buffers and returns where they were stored
+        // "baseVertex" is the index of the first vertex and "firstElement" is the index of the first element
+        static void allocate(const Vertex* vertices, size_t vertexCount, const unsigned int* elements, size_t elementCount,
+            GLint& baseVertex, size_t& firstElement);
+        // Frees the ranges returned by "allocate"
+        static void free(GLint baseVertex, size_t vertexCount, size_t firstElement, size_t elementCount);
+
+        // Binds the shared vertex array (unless it is already bound)
+        static void bind() {
+            if(bound) return;
+            glBindVertexArray(vertexArray);
+            bound = true;
+        }
+        // This must be called after binding any other vertex array so that the next "bind" does not get skipped
+        static void invalidateBinding() { bound = false; }
+
+        // Returns the size (in bytes) of the vertex and element buffers
+        static size_t getMemoryUsage() {
+            return vertexAllocator.getCapacity() * sizeof(Vertex) + elementAllocator.getCapacity() * sizeof(unsigned int);
+        }
+
+        static GLuint getVertexBuffer() { return vertexBuffer; }
+        static GLuint getElementBuffer() { return elementBuffer; }
+    };
+
+}
@@ -2,6 +2,9 @@
 
 #include <glad/gl.h>
 #include "vertex.hpp"
+#include "geometry-buffer.hpp"
+#include <vector>
+#include <cstdint>
 
 namespace our {
 
@@ -9,88 +12,140 @@ namespace our {
     #define ATTRIB_LOC_COLOR    1
     #define ATTRIB_LOC_TEXCOORD 2
     #define ATTRIB_LOC_NORMAL   3
+    // The per-instance attributes used by instanced draws, each matrix takes 4 consecutive locations (one per column)
+    #define ATTRIB_LOC_INSTANCE_M    4
+    #define ATTRIB_LOC_INSTANCE_M_IT 8
 
     class Mesh {
-        // Here, we store the object names of the 3 main components of a mesh:
-        // A vertex array object, A vertex buffer and an element buffer
-        unsigned int VBO, EBO;
-        unsigned int VAO;
+        // Used to give every mesh a unique id
+        inline static std::uint32_t nextId = 0;
+        // The mesh data lives in the shared geometry buffer (see "GeometryBuffer"), so a mesh is only a range of it:
+        // The index of the first vertex of the mesh (added to every element while drawing)
+        GLint baseVertex;
+        // The index of the first element of the mesh in the element buffer
+        size_t firstElement;
         // We need to remember the number of elements that will be draw by glDrawElements 
         GLsizei elementCount;
+        // The number of vertices in the vertex buffer
+        GLsizei vertexCount;
+        // A sphere (in the mesh local space) that contains all the vertices, it is used for culling
+        glm::vec3 boundsCenter = {0, 0, 0};
+        float boundsRadius = 0;
+        // The bounding box of the vertices (in the mesh local space), it is used for occlusion queries
+        glm::vec3 boundsMin = {0, 0, 0}, boundsMax = {0, 0, 0};
+        // A unique id of this mesh (the renderer uses it to group draws by mesh)
+        std::uint32_t id = nextId++;
     public:
+        // The number of draw calls and triangles issued by all the meshes since they were last reset (see "PerformanceHud")
+        inline static size_t drawCalls = 0, drawnTriangles = 0;
 
         // The constructor takes two vectors:
         // - vertices which contain the vertex data.
         // - elements which contain the indices of the vertices out of which each rectangle will be constructed.
-        // The mesh class does not keep a these data on the RAM. Instead, it should create
-        // a vertex buffer to store the vertex data on the VRAM,
-        // an element buffer to store the element data on the VRAM,
-        // a vertex array object to define how to read the vertex & element buffer during rendering 
+        // The mesh class does not keep a these data on the RAM. Instead, it copies them into a range of the shared
+        // vertex and element buffers on the VRAM. All the meshes share the same vertex array object
+        // (since they all use the same vertex format) which is set up by the geometry buffer
         Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& elements)
         {
             //TODO: (Req 2) Write this function
             // remember to store the number of elements in "elementCount" since you will need it for drawing
             // For the attribute locations, use the constants defined above: ATTRIB_LOC_POSITION, ATTRIB_LOC_COLOR, etc
             // Pass relevant data to the mesh class
-
-            //Vertex Buffer
-            glGenBuffers(1, &VBO);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),vertices.data(), GL_STATIC_DRAW);
-
-            //Element Buffer
-            glGenBuffers(1, &EBO);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, elements.size() * sizeof(unsigned int), elements.data(), GL_STATIC_DRAW);
-
-            //vertex array
-            glGenVertexArrays(1, &VAO);
-            glBindVertexArray(VAO);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            
-            //Define vertex attributes
-
-            //Position attribute
-            glEnableVertexAttribArray(ATTRIB_LOC_POSITION);
-            glVertexAttribPointer(ATTRIB_LOC_POSITION, 3, GL_FLOAT, false, sizeof(Vertex), (void*)offsetof(Vertex, position));
-
-            //Color attribute
-            glEnableVertexAttribArray(ATTRIB_LOC_COLOR);
-            glVertexAttribPointer(ATTRIB_LOC_COLOR, 4, GL_UNSIGNED_BYTE, true, sizeof(Vertex), (void*)offsetof(Vertex, color));
-
-            //TexCoord attribute
-            glEnableVertexAttribArray(ATTRIB_LOC_TEXCOORD);
-            glVertexAttribPointer(ATTRIB_LOC_TEXCOORD, 2, GL_FLOAT, false, sizeof(Vertex), (void*)offsetof(Vertex, tex_coord));
-
-            //Normal attribute
-            glEnableVertexAttribArray(ATTRIB_LOC_NORMAL);
-            glVertexAttribPointer(ATTRIB_LOC_NORMAL, 3, GL_FLOAT, false, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-
-            //Unbind vertex array object
-            glBindVertexArray(0);
+            GeometryBuffer::allocate(vertices.data(), vertices.size(), elements.data(), elements.size(), baseVertex, firstElement);
 
             //remember the number of elements
             elementCount = elements.size();
+            vertexCount = vertices.size();
+
+            // The bounding sphere is centered at the center of the bounding box of the vertices
+            if (!vertices.empty())
+            {
+                glm::vec3 minimum = vertices[0].position, maximum = vertices[0].position;
+                for (const auto &vertex : vertices)
+                {
+                    minimum = glm::min(minimum, vertex.position);
+                    maximum = glm::max(maximum, vertex.position);
+                }
+                boundsMin = minimum;
+                boundsMax = maximum;
+                boundsCenter = (minimum + maximum) * 0.5f;
+                for (const auto &vertex : vertices)
+                    boundsRadius = glm::max(boundsRadius, glm::distance(boundsCenter, vertex.position));
+            }
+        }
 
+        // Reads back the vertex and element data from the VRAM
+        // This is slow so it is only meant for load time processing (e.g. merging meshes into static batches)
+        // The returned elements are relative to the first vertex of the mesh
+        std::vector<Vertex> readVertices() const
+        {
+            std::vector<Vertex> vertices(vertexCount);
+            glBindBuffer(GL_COPY_READ_BUFFER, GeometryBuffer::getVertexBuffer());
+            glGetBufferSubData(GL_COPY_READ_BUFFER, baseVertex * sizeof(Vertex), vertexCount * sizeof(Vertex), vertices.data());
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            return vertices;
         }
+        std::vector<unsigned int> readElements() const
+        {
+            std::vector<unsigned int> elements(elementCount);
+            glBindBuffer(GL_COPY_READ_BUFFER, GeometryBuffer::getElementBuffer());
+            glGetBufferSubData(GL_COPY_READ_BUFFER, firstElement * sizeof(unsigned int), elementCount * sizeof(unsigned int), elements.data());
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            return elements;
+        }
+
+        // Returns the center and the radius of the mesh bounding sphere (in the mesh local space)
+        glm::vec3 getBoundsCenter() const { return boundsCenter; }
+        float getBoundsRadius() const { return boundsRadius; }
+        // Returns the corners of the mesh bounding box (in the mesh local space)
+        glm::vec3 getBoundsMin() const { return boundsMin; }
+        glm::vec3 getBoundsMax() const { return boundsMax; }
+
+        // Returns the unique id of this mesh
+        std::uint32_t getId() const { return id; }
 
-        // this function should render the mesh
         void draw() 
         {
             //TODO: (Req 2) Write this function
-            //bind to vertex array to draw elements
-            glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, 0);
+            // The shared vertex array is only bound if another vertex array was bound since the last draw
+            GeometryBuffer::bind();
+            glDrawElementsBaseVertex(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, (void *)(firstElement * sizeof(unsigned int)), baseVertex);
+            drawCalls++;
+            drawnTriangles += elementCount / 3;
+        }
+
+        // Points the per-instance attributes to "buffer"
+        // The data of the first instance starts at "offset" and every instance is "stride" bytes holding
+        // a model matrix followed by its inverse transpose (both are read one column per attribute location)
+        // Since the vertex array is shared by all the meshes, this affects the instanced draws of every mesh
+        void setInstanceAttributes(GLuint buffer, GLintptr offset, GLsizei stride)
+        {
+            GeometryBuffer::bind();
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            for (GLuint column = 0; column < 4; column++)
+            {
+                glEnableVertexAttribArray(ATTRIB_LOC_INSTANCE_M + column);
+                glVertexAttribPointer(ATTRIB_LOC_INSTANCE_M + column, 4, GL_FLOAT, false, stride, (void *)(offset + column * sizeof(glm::vec4)));
+                glVertexAttribDivisor(ATTRIB_LOC_INSTANCE_M + column, 1);
+                glEnableVertexAttribArray(ATTRIB_LOC_INSTANCE_M_IT + column);
+                glVertexAttribPointer(ATTRIB_LOC_INSTANCE_M_IT + column, 4, GL_FLOAT, false, stride, (void *)(offset + sizeof(glm::mat4) + column * sizeof(glm::vec4)));
+                glVertexAttribDivisor(ATTRIB_LOC_INSTANCE_M_IT + column, 1);
+            }
+        }
+
+        // Draws "instanceCount" instances of the mesh (the instance attributes should be set by "setInstanceAttributes" first)
+        void drawInstanced(GLsizei instanceCount)
+        {
+            GeometryBuffer::bind();
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, (void *)(firstElement * sizeof(unsigned int)), instanceCount, baseVertex);
+            drawCalls++;
+            drawnTriangles += (size_t)(elementCount / 3) * instanceCount;
         }
 
-        // this function should delete the vertex & element buffers and the vertex array object
+        // this function should return the range of the mesh to the geometry buffer
         ~Mesh(){
             //TODO: (Req 2) Write this function
-            glDeleteBuffers(1, &VBO);
-            glDeleteBuffers(1, &EBO);
-            glDeleteVertexArrays(1, &VAO);
+            GeometryBuffer::free(baseVertex, vertexCount, firstElement, elementCount);
         }
 
         Mesh(Mesh const &) = delete;
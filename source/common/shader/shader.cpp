@@ -1,4 +1,6 @@
 #include "shader.hpp"
+#include "uniform-buffer.hpp"
+#include "texture-buffer.hpp"
 
 #include <cassert>
 #include <iostream>
@@ -9,8 +11,10 @@
 std::string checkForShaderCompilationErrors(GLuint shader);
 std::string checkForLinkingErrors(GLuint program);
 
-bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
+bool our::ShaderProgram::attach(const std::string &filename, GLenum type, const std::string &defines)
 {
+    attachedFiles.push_back({filename, type, defines});
+
     // Here, we open the file and read a string from it containing the GLSL code of our shader
     std::ifstream file(filename);
     if(!file){
@@ -18,6 +22,18 @@ bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
         return false;
     }
     std::string sourceString = std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    // The defines must come after the "#version" directive since nothing but comments may precede it
+    // Every shader also gets the FRAME_BLOCK macro so that the shaders reading the "Frame" block share one declaration of it
+    {
+        size_t insertAt = 0;
+        if(size_t version = sourceString.find("#version"); version != std::string::npos){
+            size_t lineEnd = sourceString.find('\n', version);
+            insertAt = lineEnd == std::string::npos ? sourceString.size() : lineEnd + 1;
+        }
+        std::string inserted = frame_block_define + defines;
+        if(insertAt == sourceString.size() && insertAt > 0) inserted = "\n" + inserted;
+        sourceString.insert(insertAt, inserted);
+    }
     const char* sourceCStr = sourceString.c_str();
     file.close();
 
@@ -47,7 +63,7 @@ bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
 
 
 
-bool our::ShaderProgram::link() const {
+bool our::ShaderProgram::link() {
     //TODO: Complete this function
     glLinkProgram(program);
     //Note: The function "checkForLinkingErrors" checks if there is
@@ -60,10 +76,81 @@ bool our::ShaderProgram::link() const {
         std::cerr << error << std::endl;
         return false;
     }
+
+    // Now that the program is linked, we introspect its active uniforms once and cache their locations
+    // This way, "set" only needs a hash lookup instead of calling glGetUniformLocation on every call
+    uniformLocations.clear();
+    GLint uniformCount = 0, maxNameLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::string name(maxNameLength, '\0');
+    for(GLint index = 0; index < uniformCount; index++){
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, index, maxNameLength, &length, &size, &type, name.data());
+        std::string uniformName = name.substr(0, length);
+        GLint location = glGetUniformLocation(program, uniformName.c_str());
+        // Uniforms inside uniform blocks have no location so there is nothing to cache for them
+        if(location < 0) continue;
+        uniformLocations[uniformName] = location;
+        // Arrays of basic types are reported once as "name[0]" so we also register the array name itself
+        // and the location of every other element in the array
+        if(auto bracket = uniformName.rfind("[0]"); bracket != std::string::npos && bracket + 3 == uniformName.size()){
+            std::string arrayName = uniformName.substr(0, bracket);
+            uniformLocations[arrayName] = location;
+            for(GLint element = 1; element < size; element++){
+                std::string elementName = arrayName + "[" + std::to_string(element) + "]";
+                uniformLocations[elementName] = glGetUniformLocation(program, elementName.c_str());
+            }
+        }
+    }
+
+    // Connect the shared uniform blocks used by this program (if any) to their fixed binding points
+    for(const auto& block : uniform_block_bindings){
+        if(GLuint index = glGetUniformBlockIndex(program, block.name); index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, index, block.binding);
+    }
+    // And the shared buffer textures to their fixed texture units (sampler values can only be set while the program is in use)
+    // Variants are linked lazily in the middle of a frame, so the program that was in use is restored afterwards
+    GLint previousProgram = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+    bool programChanged = false;
+    for(const auto& binding : texture_buffer_bindings){
+        if(GLint location = glGetUniformLocation(program, binding.name); location >= 0){
+            if(!programChanged) glUseProgram(program);
+            programChanged = true;
+            glUniform1i(location, binding.unit);
+        }
+    }
+    if(programChanged) glUseProgram(previousProgram);
+
     // We return true if the compilation succeeded
     return true;
 }
 
+our::ShaderProgram* our::ShaderProgram::getVariant(const std::string &defines, const std::string &fragmentShader) {
+    // The key starts with the fragment shader file name (if any) on its own line followed by the defines
+    std::string key = fragmentShader.empty() ? defines : fragmentShader + "\n" + defines;
+    if(auto it = variants.find(key); it != variants.end())
+        return it->second;
+    ShaderProgram* variant = new ShaderProgram();
+    bool success = true;
+    for(const auto& file : attachedFiles){
+        if(file.type == GL_FRAGMENT_SHADER && !fragmentShader.empty())
+            success = variant->attach(fragmentShader, file.type, file.defines + defines) && success;
+        else
+            success = variant->attach(file.filename, file.type, file.defines + defines) && success;
+    }
+    if(!success || !variant->link()){
+        delete variant;
+        variant = nullptr;
+    }
+    // Failures are cached too, so that a broken variant is not recompiled every frame
+    variants[key] = variant;
+    return variant;
+}
+
 ////////////////////////////////////////////////////////////////////
 // Function to check for compilation and linking error in shaders //
 ////////////////////////////////////////////////////////////////////
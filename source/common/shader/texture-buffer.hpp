@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/gl.h>
+
+namespace our {
+
+    // These are the fixed texture units of the buffer textures shared between the renderer and the shaders
+    // The units after the ones used by the materials are reserved for them, and "ShaderProgram::link"
+    // sets every sampler found in "texture_buffer_bindings" to its unit so the renderer only binds the textures once per frame
+    #define TEXTURE_UNIT_LIGHT_DATA     5
+    #define TEXTURE_UNIT_CLUSTER_GRID   6
+    #define TEXTURE_UNIT_CLUSTER_LIGHTS 7
+
+    struct TextureBufferBinding {
+        const char* name;
+        GLint unit;
+    };
+
+    inline const TextureBufferBinding texture_buffer_bindings[] = {
+        {"light_data", TEXTURE_UNIT_LIGHT_DATA},
+        {"cluster_grid", TEXTURE_UNIT_CLUSTER_GRID},
+        {"cluster_lights", TEXTURE_UNIT_CLUSTER_LIGHTS},
+    };
+
+    // This class defines a buffer texture: a buffer whose content is read by the shaders as a 1D array of texels using texelFetch
+    // Unlike uniform buffers, their size is only limited by GL_MAX_TEXTURE_BUFFER_SIZE (at least 64K texels) which makes them
+    // suitable for data that grows with the scene (e.g. the lights)
+    class TextureBuffer {
+        // The OpenGL object names of the buffer and of the texture that reads it
+        GLuint buffer = 0, texture = 0;
+        // The size (in bytes) of the buffer storage
+        GLsizeiptr capacity;
+    public:
+        // The bytes of video memory used by the storage of all the buffer textures (see "PerformanceHud")
+        inline static size_t totalMemoryUsage = 0;
+
+        // This constructor creates the buffer and the texture which reads it as texels of the given internal format (e.g. GL_RGBA32F)
+        TextureBuffer(GLenum format, GLsizeiptr capacity = 1024) : capacity(capacity) {
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_BUFFER, texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+            totalMemoryUsage += capacity;
+        }
+
+        // This deconstructor deletes the underlying OpenGL buffer and texture
+        ~TextureBuffer() {
+            glDeleteTextures(1, &texture);
+            glDeleteBuffers(1, &buffer);
+            totalMemoryUsage -= capacity;
+        }
+
+        // This replaces the content of the buffer with "size" bytes from "data"
+        // The storage is orphaned first so that the driver does not wait for the draws still reading the old content
+        void update(const void* data, GLsizeiptr size) {
+            totalMemoryUsage -= capacity;
+            while(capacity < size) capacity *= 2;
+            totalMemoryUsage += capacity;
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+            if(size > 0) glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+
+        // This binds the texture to the given texture unit
+        void bind(GLint unit) const {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_BUFFER, texture);
+        }
+
+        TextureBuffer(const TextureBuffer&) = delete;
+        TextureBuffer& operator=(const TextureBuffer&) = delete;
+    };
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+namespace our {
+
+    // These are the fixed binding points of the uniform blocks shared between the renderer and the shaders
+    // GLSL 3.30 cannot pick a binding point in the shader (layout(binding=...) needs 4.20),
+    // so "ShaderProgram::link" connects every block found in "uniform_block_bindings" to its binding point
+    #define UNIFORM_BLOCK_FRAME  0
+
+    struct UniformBlockBinding {
+        const char* name;
+        GLuint binding;
+    };
+
+    inline const UniformBlockBinding uniform_block_bindings[] = {
+        {"Frame", UNIFORM_BLOCK_FRAME},
+    };
+
+    // The CPU side of the "Frame" uniform block (std140 layout) which holds the data shared by every draw in a frame
+    // The padding members are there to match the std140 rule that a vec3 is aligned to 16 bytes
+    struct FrameBlock {
+        glm::mat4 VP;
+        glm::vec3 camera_position;
+        GLint directional_light_count;
+        glm::vec3 camera_forward;
+        GLint global_light_count;
+        // The size of a cluster tile in pixels and the factors that give the cluster slice of a depth (see "LightClusters")
+        glm::vec2 cluster_tile_size;
+        float cluster_z_scale, cluster_z_bias;
+        struct {
+            glm::vec3 top; float _pad0;
+            glm::vec3 horizon; float _pad1;
+            glm::vec3 bottom; float _pad2;
+        } sky;
+    };
+    static_assert(sizeof(FrameBlock) == 160, "FrameBlock must match the std140 layout of the Frame block");
+
+    // The GLSL side of the "Frame" block, it is the only declaration of the block so it must be kept in sync with "FrameBlock"
+    // "ShaderProgram::attach" defines it as the FRAME_BLOCK macro in every shader, and the shaders that read the block expand it
+    // (it is a macro, not an inserted declaration, since other shaders use the same names, e.g. "camera_position" in sky.vert)
+    inline const char* frame_block_define =
+        "#define FRAME_BLOCK "
+        "struct Sky { vec3 top, horizon, bottom; }; "
+        "layout(std140) uniform Frame { "
+            "mat4 VP; "
+            "vec3 camera_position; "
+            "int directional_light_count; "
+            "vec3 camera_forward; "
+            "int global_light_count; "
+            "vec2 cluster_tile_size; "
+            "float cluster_z_scale, cluster_z_bias; "
+            "Sky sky; "
+        "};\n";
+
+    // This class defines an OpenGL buffer which will be used as a GL_UNIFORM_BUFFER
+    // The data written to it must follow the std140 layout of the block it is bound to
+    class UniformBuffer {
+        // The OpenGL object name of this buffer
+        GLuint name = 0;
+        // The size (in bytes) of the buffer storage
+        GLsizeiptr size;
+    public:
+        // This constructor creates an OpenGL buffer and allocates "size" bytes of storage for it
+        // The storage is marked as dynamic since we plan to rewrite it every frame
+        UniformBuffer(GLsizeiptr size) : size(size) {
+            glGenBuffers(1, &name);
+            glBindBuffer(GL_UNIFORM_BUFFER, name);
+            glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        // This deconstructor deletes the underlying OpenGL buffer
+        ~UniformBuffer() {
+            glDeleteBuffers(1, &name);
+        }
+
+        GLsizeiptr getSize() const { return size; }
+
+        // This writes "dataSize" bytes from "data" into the buffer starting at "offset"
+        void update(const void* data, GLsizeiptr dataSize, GLintptr offset = 0) const {
+            glBindBuffer(GL_UNIFORM_BUFFER, name);
+            glBufferSubData(GL_UNIFORM_BUFFER, offset, dataSize, data);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        // This binds the whole buffer to the given uniform block binding point
+        void bind(GLuint binding) const {
+            glBindBufferBase(GL_UNIFORM_BUFFER, binding, name);
+        }
+
+        UniformBuffer(const UniformBuffer&) = delete;
+        UniformBuffer& operator=(const UniformBuffer&) = delete;
+    };
+
+}
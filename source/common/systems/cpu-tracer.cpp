@@ -0,0 +1,168 @@
+#include "cpu-tracer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace our
+{
+
+    namespace
+    {
+        // The events of a thread. Only its own thread writes to it, and "written" is published after every event
+        // so a dump (from any thread) reads the events that are complete
+        struct ThreadBuffer {
+            std::unique_ptr<CpuTraceEvent[]> events = std::make_unique<CpuTraceEvent[]>(CPU_TRACE_BUFFER_CAPACITY);
+            std::atomic<uint64_t> written{0};
+            int id = 0;
+            const char *name = nullptr;
+        };
+
+        std::atomic<bool> enabled{false};
+        std::string outputPath;
+        std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        // The buffers of every thread that recorded an event. They are kept after their thread ends so that its events are still dumped
+        std::mutex buffersMutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        thread_local ThreadBuffer *threadBuffer = nullptr;
+
+        ThreadBuffer &getThreadBuffer()
+        {
+            if (!threadBuffer)
+            {
+                std::lock_guard<std::mutex> lock(buffersMutex);
+                auto &buffer = buffers.emplace_back(std::make_unique<ThreadBuffer>());
+                buffer->id = (int)buffers.size() - 1;
+                threadBuffer = buffer.get();
+            }
+            return *threadBuffer;
+        }
+
+        // Writes a string as a json string (with the quotes and the escaped characters)
+        // A cut argument may end in the middle of a UTF-8 character, so the invalid bytes are replaced instead of throwing
+        void writeString(std::ostream &stream, const char *string)
+        {
+            stream << nlohmann::json(string).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+        }
+    }
+
+    void CpuTracer::initialize(const nlohmann::json &config)
+    {
+        epoch = std::chrono::steady_clock::now();
+        outputPath = config.is_object() ? config.value("output", "") : "";
+        // An output file means that the trace was requested, so the tracer is enabled even if the config says otherwise
+        enabled = config.is_object() && (config.value("enabled", true) || !outputPath.empty());
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            for (auto &buffer : buffers)
+                buffer->written = 0;
+        }
+        // The thread that initializes the tracer is the main thread
+        if (enabled)
+            setThreadName("Main");
+    }
+
+    void CpuTracer::destroy()
+    {
+        if (!enabled)
+            return;
+        if (!outputPath.empty())
+        {
+            if (dump(outputPath))
+                std::cout << "CPU trace saved to: " << outputPath << std::endl;
+            else
+                std::cerr << "Failed to save the CPU trace to: " << outputPath << std::endl;
+        }
+        enabled = false;
+    }
+
+    bool CpuTracer::isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    void CpuTracer::setThreadName(const char *name)
+    {
+        ThreadBuffer &buffer = getThreadBuffer();
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffer.name = name;
+    }
+
+    int64_t CpuTracer::now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void CpuTracer::record(const char *name, int64_t start, int64_t end, const char *argument)
+    {
+        ThreadBuffer &buffer = getThreadBuffer();
+        uint64_t index = buffer.written.load(std::memory_order_relaxed);
+        CpuTraceEvent &event = buffer.events[index % CPU_TRACE_BUFFER_CAPACITY];
+        event.name = name;
+        event.start = start;
+        event.duration = end - start;
+        if (argument)
+        {
+            std::strncpy(event.argument, argument, CPU_TRACE_ARGUMENT_LENGTH - 1);
+            event.argument[CPU_TRACE_ARGUMENT_LENGTH - 1] = '\0';
+        }
+        else
+            event.argument[0] = '\0';
+        buffer.written.store(index + 1, std::memory_order_release);
+    }
+
+    bool CpuTracer::dump(const std::string &path)
+    {
+        std::filesystem::path parent = std::filesystem::path(path).parent_path();
+        if (!parent.empty())
+        {
+            std::error_code error;
+            std::filesystem::create_directories(parent, error);
+        }
+        std::ofstream file(path);
+        if (!file)
+            return false;
+
+        // The trace-event format: a "M" (metadata) event names each thread and a "X" (complete) event is a scope
+        // The times are in microseconds
+        char time[64];
+        bool first = true;
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (auto &buffer : buffers)
+        {
+            if (buffer->name)
+            {
+                file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":";
+                writeString(file, buffer->name);
+                file << "}}";
+                first = false;
+            }
+            uint64_t written = buffer->written.load(std::memory_order_acquire);
+            uint64_t begin = written > CPU_TRACE_BUFFER_CAPACITY ? written - CPU_TRACE_BUFFER_CAPACITY : 0;
+            for (uint64_t index = begin; index < written; index++)
+            {
+                const CpuTraceEvent &event = buffer->events[index % CPU_TRACE_BUFFER_CAPACITY];
+                file << (first ? "\n" : ",\n") << "{\"name\":";
+                writeString(file, event.name);
+                std::snprintf(time, sizeof(time), ",\"ts\":%.3f,\"dur\":%.3f", event.start * 1e-3, event.duration * 1e-3);
+                file << ",\"cat\":\"cpu\",\"ph\":\"X\"" << time << ",\"pid\":1,\"tid\":" << buffer->id;
+                if (event.argument[0])
+                {
+                    file << ",\"args\":{\"argument\":";
+                    writeString(file, event.argument);
+                    file << "}";
+                }
+                file << "}";
+                first = false;
+            }
+        }
+        file << "\n]}" << std::endl;
+        return (bool)file;
+    }
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <json/json.hpp>
+#include <cstdint>
+#include <string>
+
+namespace our
+{
+
+    // The number of events kept by each thread, once a thread fills its buffer its oldest events are overwritten
+    // (with about 50 scopes per frame, this is the last 20 seconds at 60 frames per second)
+    #define CPU_TRACE_BUFFER_CAPACITY 65536
+    // The longest argument (e.g. an asset name) stored with an event, longer arguments are cut
+    #define CPU_TRACE_ARGUMENT_LENGTH 32
+
+    // A scope that ended: its name, when it started and how long it took (in nanoseconds since the tracer was initialized)
+    struct CpuTraceEvent {
+        const char* name;
+        int64_t start, duration;
+        char argument[CPU_TRACE_ARGUMENT_LENGTH];
+    };
+
+    // The CPU tracer records named scopes (see "TRACE_SCOPE") and writes them as a Chrome trace-event json file
+    // that can be opened in chrome://tracing or https://ui.perfetto.dev to inspect the frame hitches and the loading stalls.
+    // Every thread records into its own buffer so recording an event never takes a lock (only the first event of a thread does,
+    // to register its buffer). The buffers are rings so the tracer can stay enabled and always holds the latest events.
+    // Like the pipeline state cache, the tracer is shared by the whole application
+    class CpuTracer {
+    public:
+        // Reads the "cpuTracer" object of the application config ({"enabled": true, "output": "trace.json"})
+        // If there is an output file, the trace is written to it when the tracer is destroyed
+        static void initialize(const nlohmann::json& config);
+        static void destroy();
+
+        static bool isEnabled();
+
+        // Names the calling thread in the trace (the name must outlive the tracer, a string literal)
+        static void setThreadName(const char* name);
+
+        // Returns the time in nanoseconds since the tracer was initialized
+        static int64_t now();
+        // Records a scope of the calling thread. The name must outlive the tracer (a string literal), the argument is copied
+        static void record(const char* name, int64_t start, int64_t end, const char* argument = nullptr);
+
+        // Writes the events recorded so far by every thread to a json file and returns false if it could not be written
+        // Events that another thread records while the file is being written may be missing or cut
+        static bool dump(const std::string& path);
+    };
+
+    // Records the scope in which it lives (see "TRACE_SCOPE")
+    class CpuTraceScope {
+        const char* name;
+        const char* argument;
+        int64_t start;
+        bool active;
+    public:
+        explicit CpuTraceScope(const char* name, const char* argument = nullptr) : name(name), argument(argument), active(CpuTracer::isEnabled()) {
+            if (active) start = CpuTracer::now();
+        }
+        ~CpuTraceScope() {
+            if (active) CpuTracer::record(name, start, CpuTracer::now(), argument);
+        }
+
+        CpuTraceScope(const CpuTraceScope&) = delete;
+        CpuTraceScope& operator=(const CpuTraceScope&) = delete;
+    };
+
+}
+
+#define CPU_TRACE_CONCATENATE_(a, b) a##b
+#define CPU_TRACE_CONCATENATE(a, b) CPU_TRACE_CONCATENATE_(a, b)
+// Traces the rest of the current scope under the given name (a string literal)
+#define TRACE_SCOPE(name) our::CpuTraceScope CPU_TRACE_CONCATENATE(traceScope, __LINE__)(name)
+// Same as "TRACE_SCOPE" but also stores an argument (e.g. the name of the asset being loaded) which must live until the end of the scope
+#define TRACE_SCOPE_ARGUMENT(name, argument) our::CpuTraceScope CPU_TRACE_CONCATENATE(traceScope, __LINE__)(name, argument)
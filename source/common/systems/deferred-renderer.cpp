@@ -0,0 +1,138 @@
+#include "deferred-renderer.hpp"
+#include "../texture/texture-utils.hpp"
+#include "gpu-profiler.hpp"
+#include "cpu-tracer.hpp"
+#include <iostream>
+
+namespace our
+{
+
+    void DeferredRenderer::initialize(glm::ivec2 windowSize, const nlohmann::json &config, Entity *player)
+    {
+        ForwardRenderer::initialize(windowSize, config, player);
+
+        // The normals need a signed format, the other targets are colors so 8 bits are enough
+        const GLenum formats[GBUFFER_TARGET_COUNT] = {GL_RGBA8, GL_RGBA16F, GL_RGBA8, GL_RGBA8};
+        glGenFramebuffers(1, &gBuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, gBuffer);
+        GLenum drawBuffers[GBUFFER_TARGET_COUNT];
+        for (int target = 0; target < GBUFFER_TARGET_COUNT; target++)
+        {
+            gBufferTargets[target] = texture_utils::empty(formats[target], windowSize);
+            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + target, GL_TEXTURE_2D, gBufferTargets[target]->getOpenGLName(), 0);
+            drawBuffers[target] = GL_COLOR_ATTACHMENT0 + target;
+        }
+        gBufferDepth = texture_utils::empty(GL_DEPTH_COMPONENT24, windowSize);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gBufferDepth->getOpenGLName(), 0);
+        // The draw buffers are part of the framebuffer state so they only need to be set once
+        glDrawBuffers(GBUFFER_TARGET_COUNT, drawBuffers);
+        if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "The G-buffer is incomplete" << std::endl;
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+        lightingShader = new ShaderProgram();
+        lightingShader->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
+        lightingShader->attach("assets/shaders/light.frag", GL_FRAGMENT_SHADER, DEFERRED_LIGHTING_SHADER_DEFINES);
+        lightingShader->link();
+        glGenVertexArrays(1, &lightingVertexArray);
+
+        lightingPipelineState.depthTesting.enabled = true;
+        lightingPipelineState.depthTesting.function = GL_ALWAYS;
+        lightingPipelineState.depthMask = true;
+    }
+
+    void DeferredRenderer::destroy()
+    {
+        glDeleteFramebuffers(1, &gBuffer);
+        gBuffer = 0;
+        for (auto &target : gBufferTargets)
+        {
+            delete target;
+            target = nullptr;
+        }
+        delete gBufferDepth;
+        gBufferDepth = nullptr;
+        delete lightingShader;
+        lightingShader = nullptr;
+        lightingProgram = nullptr;
+        glDeleteVertexArrays(1, &lightingVertexArray);
+        lightingVertexArray = 0;
+        ForwardRenderer::destroy();
+    }
+
+    RenderPass DeferredRenderer::getOpaquePass(const RenderCommand &command) const
+    {
+        // The G-buffer has no room for the baked light so the meshes that have it are drawn forward
+        if (command.bakedLighting)
+            return RenderPass::OPAQUE_PASS;
+        return dynamic_cast<const LightingMaterial *>(command.material) ? RenderPass::DEFERRED_PASS : RenderPass::OPAQUE_PASS;
+    }
+
+    void DeferredRenderer::drawOpaqueCommands(const glm::mat4 &VP)
+    {
+        // The deferred commands are at the front of the queue since the pass is the most significant field of the sort key
+        size_t deferredCount = 0;
+        while (deferredCount < opaqueCommands.size() &&
+               (RenderPass)(opaqueCommands[deferredCount].sortKey >> 62) == RenderPass::DEFERRED_PASS)
+            deferredCount++;
+
+        if (deferredCount > 0)
+        {
+            // Geometry pass: the surfaces of the lit commands are written into the G-buffer
+            GpuProfiler::beginScope("G-buffer");
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, gBuffer);
+            glColorMask(true, true, true, true);
+            glDepthMask(true);
+            PipelineState::invalidateCache();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawCommands(opaqueCommands.data(), deferredCount, 0, VP, DrawMode::GBUFFER);
+            GpuProfiler::endScope();
+
+            // Lighting pass: every covered pixel of the target is lit once and gets the depth of the G-buffer
+            GpuProfileScope scope("Deferred lighting");
+            TRACE_SCOPE("Deferred lighting");
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, getTargetFramebuffer());
+            lightingPipelineState.setup();
+            // The lighting pass is specialized for the lights of the frame like the forward lit shaders
+            ShaderProgram *program = lightingShader->getVariant(lightDefines[0]);
+            if (!program)
+                program = lightingShader;
+            program->use();
+            if (program != lightingProgram)
+            {
+                // The G-buffer textures are always bound to the first units
+                program->set("gbuffer.albedo", (GLint)GBUFFER_ALBEDO);
+                program->set("gbuffer.normal", (GLint)GBUFFER_NORMAL);
+                program->set("gbuffer.specular", (GLint)GBUFFER_SPECULAR);
+                program->set("gbuffer.emissive", (GLint)GBUFFER_EMISSIVE);
+                program->set("gbuffer.depth", (GLint)GBUFFER_TARGET_COUNT);
+                inverseVPLocation = program->getUniformLocation("inverse_VP");
+                lightingProgram = program;
+            }
+            program->set(inverseVPLocation, glm::inverse(VP));
+            for (int target = 0; target < GBUFFER_TARGET_COUNT; target++)
+            {
+                glActiveTexture(GL_TEXTURE0 + target);
+                gBufferTargets[target]->bind();
+                glBindSampler(target, 0);
+            }
+            glActiveTexture(GL_TEXTURE0 + GBUFFER_TARGET_COUNT);
+            gBufferDepth->bind();
+            glBindSampler(GBUFFER_TARGET_COUNT, 0);
+            glBindVertexArray(lightingVertexArray);
+            GeometryBuffer::invalidateBinding();
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+
+        // The rest of the opaque commands are drawn forward, depth tested against the lit surfaces
+        drawForwardOpaqueCommands(deferredCount, VP);
+    }
+
+    ForwardRenderer *createRenderer(const nlohmann::json &config)
+    {
+        if (config.is_object() && config.value<std::string>("type", "forward") == "deferred")
+            return new DeferredRenderer();
+        return new ForwardRenderer();
+    }
+
+}
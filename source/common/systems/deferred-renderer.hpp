@@ -0,0 +1,48 @@
+#pragma once
+
+#include "forward-renderer.hpp"
+
+namespace our
+{
+
+    // The defines used to compile the lighting pass from the lit material shader ("light.frag")
+    #define DEFERRED_LIGHTING_SHADER_DEFINES "#define DEFERRED_LIGHTING\n"
+
+    // The color targets of the G-buffer, in the order of the fragment shader outputs
+    enum GBufferTarget {
+        GBUFFER_ALBEDO,   // albedo (RGB) and ambient occlusion (A)
+        GBUFFER_NORMAL,   // world space normal
+        GBUFFER_SPECULAR, // specular (RGB) and roughness (A)
+        GBUFFER_EMISSIVE, // emissive
+        GBUFFER_TARGET_COUNT
+    };
+
+    // A deferred renderer draws the surface of the lit objects into a G-buffer and then lights every pixel once
+    // with a fullscreen pass, so the lighting cost depends on the number of pixels and not on the number of objects drawn over them
+    // The lighting pass uses the same light clusters as the forward renderer, so each pixel only loops over the lights of its cluster
+    // Everything else (unlit opaque objects, the sky, the transparent objects and the postprocessing) is drawn as in the forward renderer
+    class DeferredRenderer : public ForwardRenderer {
+        GLuint gBuffer = 0;
+        Texture2D *gBufferTargets[GBUFFER_TARGET_COUNT] = {};
+        Texture2D *gBufferDepth = nullptr;
+        // The lighting pass: "fullscreen.vert" with the DEFERRED_LIGHTING variant of "light.frag"
+        ShaderProgram *lightingShader = nullptr;
+        // The variant of the lighting pass used last (its sampler units are set when it changes)
+        ShaderProgram *lightingProgram = nullptr;
+        GLint inverseVPLocation = -1;
+        GLuint lightingVertexArray = 0;
+        // The lighting pass writes the depth of the G-buffer into the target so it must write depth without testing it
+        PipelineState lightingPipelineState;
+    protected:
+        // The commands of the lit materials are drawn into the G-buffer
+        RenderPass getOpaquePass(const RenderCommand& command) const override;
+        void drawOpaqueCommands(const glm::mat4& VP) override;
+    public:
+        void initialize(glm::ivec2 windowSize, const nlohmann::json &config, Entity *player = nullptr) override;
+        void destroy() override;
+    };
+
+    // Creates the renderer picked by the "type" ("forward" or "deferred") of the renderer configuration
+    ForwardRenderer* createRenderer(const nlohmann::json& config);
+
+}
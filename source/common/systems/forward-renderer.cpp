@@ -2,6 +2,8 @@
 #include "../mesh/mesh-utils.hpp"
 #include "../texture/texture-utils.hpp"
 #include "free-player-controller.hpp"
+#include "gpu-profiler.hpp"
+#include "cpu-tracer.hpp"
 #include <iostream>
 namespace our
 {
@@ -10,56 +12,82 @@ namespace our
     {
         // First, we store the window size for later use
         this->windowSize = windowSize;
+        this->renderSize = windowSize;
         this->player = player;
+        // The shaders may have been reloaded since the last time we were initialized
+        rendererUniforms.clear();
+        weightedBlendedSupport.clear();
+        instancingSupport.clear();
+        // Create the uniform buffer and the light clusters that hold the per-frame data shared by all the lit draws
+        frameUniforms = new UniformBuffer(sizeof(FrameBlock));
+        lightClusters.initialize();
+        // Create the buffer to which the instance data is streamed every frame
+        if (config.is_object())
+        {
+            instancingEnabled = config.value("instancing", true);
+            frustumCullingEnabled = config.value("frustumCulling", true);
+            occlusionCullingEnabled = config.value("occlusionCulling", false);
+            depthPrepassEnabled = config.value("depthPrepass", false);
+            weightedBlendedEnabled = config.value("weightedBlendedOIT", false);
+        }
+        // The governor needs the time of every frame on the GPU
+        qualityGovernor.deserialize(config.is_object() && config.contains("qualityGovernor") ? config["qualityGovernor"] : nlohmann::json());
+        if (qualityGovernor.isEnabled() || qualityGovernor.isOverlayEnabled())
+        {
+            glGenQueries(FRAME_TIME_QUERY_COUNT, frameTimeQueries);
+            for (auto &issued : frameTimeQueryIssued)
+                issued = false;
+            frameTimeQueryIndex = 0;
+        }
+        if (occlusionCullingEnabled)
+            occlusionCuller.initialize();
+        glGenBuffers(1, &instanceBuffer);
         // Then we check if there is a sky texture in the configuration
         if (config.contains("sky"))
         {
-            // First, we create a sphere which will be used to draw the sky
-            this->skySphere = mesh_utils::sphere(glm::ivec2(16, 16));
-
-            // We can draw the sky using the same shader used to draw textured objects
-            ShaderProgram *skyShader = new ShaderProgram();
-            skyShader->attach("assets/shaders/textured.vert", GL_VERTEX_SHADER);
-            skyShader->attach("assets/shaders/textured.frag", GL_FRAGMENT_SHADER);
+            // The sky is a fullscreen triangle which samples a cubemap in the direction of every pixel
+            skyShader = new ShaderProgram();
+            skyShader->attach("assets/shaders/sky.vert", GL_VERTEX_SHADER);
+            skyShader->attach("assets/shaders/sky.frag", GL_FRAGMENT_SHADER);
             skyShader->link();
-
-            // TODO: (Req 10) Pick the correct pipeline state to draw the sky
-            //  Hints: the sky will be draw after the opaque objects so we would need depth testing but which depth funtion should we pick?
-
-            //  We will draw the sphere from the inside, so what options should we pick for the face culling.
-            //we need to cull the front face because we'll draw the sphere from inside
-            PipelineState skyPipelineState{};
+            skyShader->use();
+            skyShader->set("sky", (GLint)0);
+            skyInverseVPLocation = skyShader->getUniformLocation("inverse_VP");
+            skyCameraPositionLocation = skyShader->getUniformLocation("camera_position");
+            glGenVertexArrays(1, &skyVertexArray);
+
+            // The sky is drawn after the opaque objects at the far plane, so the depth test only lets it through where nothing was drawn
+            // (and the depth does not need to be written since it is already 1 there)
             skyPipelineState.depthTesting.enabled = true;
             skyPipelineState.depthTesting.function = GL_LEQUAL;
-            skyPipelineState.faceCulling.enabled = true;
-            skyPipelineState.faceCulling.culledFace = GL_FRONT;
-            skyPipelineState.setup();
-
+            skyPipelineState.depthMask = false;
 
-            // Load the sky texture (note that we don't need mipmaps since we want to avoid any unnecessary blurring while rendering the sky)
-            std::string skyTextureFile = config.value<std::string>("sky", "");
-            Texture2D *skyTexture = texture_utils::loadImage(skyTextureFile, false);
-
-            // Setup a sampler for the sky
-            Sampler *skySampler = new Sampler();
-            skySampler->set(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            // The sky uses mipmaps (which the equirectangular image could not use since its seam would pick the smallest mip)
+            skySampler = new Sampler();
+            skySampler->set(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
             skySampler->set(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            skySampler->set(GL_TEXTURE_WRAP_S, GL_REPEAT);
+            skySampler->set(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
             skySampler->set(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-            // Combine all the aforementioned objects (except the mesh) into a material
-            this->skyMaterial = new TexturedMaterial();
-            this->skyMaterial->shader = skyShader;
-            this->skyMaterial->texture = skyTexture;
-            this->skyMaterial->sampler = skySampler;
-            this->skyMaterial->pipelineState = skyPipelineState;
-            this->skyMaterial->tint = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
-            this->skyMaterial->alphaThreshold = 1.0f;
-            this->skyMaterial->transparent = false;
+            skySampler->set(GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+            // The image is decoded here but it is converted into a cubemap on a worker thread while the rest of the state is initialized,
+            // and the cubemap is uploaded by the first "render"
+            glm::ivec2 skyImageSize;
+            std::vector<texture_utils::Pixel> skyImage = texture_utils::loadPixels(config.value<std::string>("sky", ""), skyImageSize);
+            if (!skyImage.empty())
+            {
+                // A face covers a quarter of the horizon, so a quarter of the image width keeps its resolution
+                int faceSize = std::min(skyImageSize.x / 4, MAX_SKY_FACE_SIZE);
+                skyFaces = std::async(std::launch::async, [image = std::move(skyImage), skyImageSize, faceSize]()
+                                      { return texture_utils::equirectangularToCubemap(image, skyImageSize, faceSize); });
+            }
         }
 
-        // Then we check if there is a postprocessing shader in the configuration
+        // Then we check if there is a postprocessing chain in the configuration
         if (config.contains("postprocess"))
+            postprocessChain.initialize(config["postprocess"], config.value("postprocessFadeTime", 0.0f));
+        if (postprocessChain.isEnabled())
         {
             // TODO: (Req 11) Create a framebuffer
             glGenFramebuffers(1, &postprocessFrameBuffer); //generate framebuffer called postprocessFrameBuffer
@@ -89,66 +117,441 @@ namespace our
 
             // TODO: (Req 11) Unbind the framebuffer just to be safe
             glBindFramebuffer(GL_DRAW_FRAMEBUFFER,0);
-            // Create a vertex array to use for drawing the texture
+            // Create a vertex array to use for drawing the fullscreen triangles of the renderer
             glGenVertexArrays(1, &postProcessVertexArray);
+        }
 
-            // Create a sampler to use for sampling the scene texture in the post processing shader
-            Sampler *postprocessSampler = new Sampler();
-            postprocessSampler->set(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            postprocessSampler->set(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            postprocessSampler->set(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            postprocessSampler->set(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-            // Create the post processing shader
-            ShaderProgram *postprocessShader = new ShaderProgram();
-            postprocessShader->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
-            postprocessShader->attach(config.value<std::string>("postprocess", ""), GL_FRAGMENT_SHADER);
-            postprocessShader->link();
-
-            // Create a post processing material
-            postprocessMaterial = new TexturedMaterial();
-            postprocessMaterial->shader = postprocessShader;
-            postprocessMaterial->texture = colorTarget;
-            postprocessMaterial->sampler = postprocessSampler;
-            // The default options are fine but we don't need to interact with the depth buffer
-            // so it is more performant to disable the depth mask
-            postprocessMaterial->pipelineState.depthMask = false;
+        if (weightedBlendedEnabled && !postprocessChain.isEnabled())
+        {
+            std::cerr << "Weighted blended OIT needs a postprocess framebuffer, the transparent objects will be sorted instead" << std::endl;
+            weightedBlendedEnabled = false;
         }
+        if (weightedBlendedEnabled)
+        {
+            // The accumulation needs a float format since the weighted colors go way above 1, and the weight only needs one channel
+            glGenFramebuffers(1, &weightedBlendedFrameBuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, weightedBlendedFrameBuffer);
+            accumulationTarget = texture_utils::empty(GL_RGBA16F, windowSize);
+            weightTarget = texture_utils::empty(GL_R16F, windowSize);
+            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulationTarget->getOpenGLName(), 0);
+            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, weightTarget->getOpenGLName(), 0);
+            // The transparent surfaces are depth tested against the opaque scene
+            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTarget->getOpenGLName(), 0);
+            const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+            glDrawBuffers(2, drawBuffers);
+            if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cerr << "The weighted blended OIT framebuffer is incomplete" << std::endl;
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+            compositeShader = new ShaderProgram();
+            compositeShader->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
+            compositeShader->attach("assets/shaders/weighted-blended-oit.frag", GL_FRAGMENT_SHADER);
+            compositeShader->link();
+            compositeShader->use();
+            compositeShader->set("accumulation", (GLint)0);
+            compositeShader->set("weight", (GLint)1);
+
+            // The average transparent color is blended over the scene by the total coverage of the transparent surfaces
+            compositePipelineState.blending.enabled = true;
+            compositePipelineState.depthMask = false;
+        }
+    }
+
+    const RendererUniforms& ForwardRenderer::getUniforms(ShaderProgram* shader)
+    {
+        if (auto it = rendererUniforms.find(shader); it != rendererUniforms.end())
+            return it->second;
+
+        RendererUniforms uniforms;
+        uniforms.transform = shader->getUniformLocation("transform");
+        uniforms.M = shader->getUniformLocation("M");
+        uniforms.M_IT = shader->getUniformLocation("M_IT");
+        uniforms.lit = shader->getUniformLocation("light_data") >= 0;
+        return rendererUniforms[shader] = uniforms;
     }
 
     void ForwardRenderer::destroy()
     {
-        // Delete all objects related to the sky
-        if (skyMaterial)
+        // Delete all objects related to the sky (waiting for the cubemap conversion if it is still running)
+        if (skyShader)
         {
-            delete skySphere;
-            delete skyMaterial->shader;
-            delete skyMaterial->texture;
-            delete skyMaterial->sampler;
-            delete skyMaterial;
+            if (skyFaces.valid())
+                skyFaces.wait();
+            skyFaces = {};
+            delete skyShader;
+            delete skyTexture;
+            delete skySampler;
+            glDeleteVertexArrays(1, &skyVertexArray);
+            skyShader = nullptr;
+            skyTexture = nullptr;
+            skySampler = nullptr;
+            skyVertexArray = 0;
         }
         // Delete all objects related to post processing
-        if (postprocessMaterial)
+        if (postprocessChain.isEnabled())
         {
             glDeleteFramebuffers(1, &postprocessFrameBuffer);
             glDeleteVertexArrays(1, &postProcessVertexArray);
             delete colorTarget;
             delete depthTarget;
-            delete postprocessMaterial->sampler;
-            delete postprocessMaterial->shader;
-            delete postprocessMaterial;
+            postprocessFrameBuffer = postProcessVertexArray = 0;
+            colorTarget = depthTarget = nullptr;
         }
+        postprocessChain.destroy();
+        if (frameTimeQueries[0])
+        {
+            glDeleteQueries(FRAME_TIME_QUERY_COUNT, frameTimeQueries);
+            for (auto &query : frameTimeQueries)
+                query = 0;
+        }
+        if (weightedBlendedEnabled)
+        {
+            glDeleteFramebuffers(1, &weightedBlendedFrameBuffer);
+            weightedBlendedFrameBuffer = 0;
+            delete accumulationTarget;
+            delete weightTarget;
+            delete compositeShader;
+            accumulationTarget = weightTarget = nullptr;
+            compositeShader = nullptr;
+        }
+        weightedBlendedSupport.clear();
+        instancingSupport.clear();
         lights = {};
+        rendererUniforms.clear();
+        delete frameUniforms;
+        frameUniforms = nullptr;
+        lightClusters.destroy();
+        glDeleteBuffers(1, &instanceBuffer);
+        instanceBuffer = 0;
+        // The retained commands are dropped (with their occlusion queries) since the world may not outlive the renderer
+        for (auto &retained : retainedCommands)
+            occlusionCuller.release(retained.occlusion);
+        retainedCommands.clear();
+        retainedBounds.clear();
+        retainedWorld = nullptr;
+        occlusionCuller.destroy();
+    }
+
+    void ForwardRenderer::setupMaterial(const Material *material, ShaderProgram *program, DrawMode mode, bool depthOnlyProgram)
+    {
+        // The depth only variant has no material uniforms, so only the program and the pipeline state are needed
+        if (depthOnlyProgram)
+            program->use();
+        else
+            material->setup(program);
+        if (mode == DrawMode::COLOR || mode == DrawMode::GBUFFER)
+            return;
+        // The material pipeline state is adjusted on top of what it set up (the state cache only issues the differences)
+        PipelineState pipelineState = material->pipelineState;
+        if (mode == DrawMode::DEPTH_ONLY)
+        {
+            pipelineState.colorMask = {false, false, false, false};
+        }
+        else if (mode == DrawMode::WEIGHTED_BLENDED)
+        {
+            // The weighted colors are added while the alpha (which holds the revealage) is multiplied by (1 - alpha)
+            pipelineState.blending.enabled = true;
+            pipelineState.blending.equation = GL_FUNC_ADD;
+            pipelineState.blending.sourceFactor = GL_ONE;
+            pipelineState.blending.destinationFactor = GL_ONE;
+            pipelineState.blending.separateAlpha = true;
+            pipelineState.blending.sourceAlphaFactor = GL_ZERO;
+            pipelineState.blending.destinationAlphaFactor = GL_ONE_MINUS_SRC_ALPHA;
+            pipelineState.colorMask = {true, true, true, true};
+            pipelineState.depthMask = false;
+        }
+        else
+        {
+            pipelineState.depthTesting.function = GL_EQUAL;
+            pipelineState.depthMask = false;
+        }
+        pipelineState.setup();
+    }
+
+    void ForwardRenderer::drawCommands(const RenderCommand *commands, size_t commandCount, size_t instanceBase, const glm::mat4 &VP, DrawMode mode)
+    {
+        for (size_t first = 0; first < commandCount;)
+        {
+            const RenderCommand &command = commands[first];
+            // The commands are sorted so the ones sharing the same mesh and material are next to each other
+            size_t count = 1;
+            while (first + count < commandCount && commands[first + count].mesh == command.mesh && commands[first + count].material == command.material)
+                count++;
+
+            // Every mode must pick the same (instanced or not) path for a run since the depth of both paths may differ slightly
+            ShaderProgram *instancedShader = nullptr;
+            if (instancingEnabled && count > 1 && supportsInstancing(command.material->shader))
+                instancedShader = command.material->shader->getVariant(INSTANCED_SHADER_DEFINES);
+
+            if (instancedShader)
+            {
+                ShaderProgram *program = instancedShader, *depthOnly = nullptr;
+                if (mode == DrawMode::DEPTH_ONLY)
+                    depthOnly = command.material->shader->getVariant(INSTANCED_SHADER_DEFINES, DEPTH_ONLY_FRAGMENT_SHADER);
+                else if (mode == DrawMode::GBUFFER)
+                    program = command.material->shader->getVariant(INSTANCED_SHADER_DEFINES GBUFFER_SHADER_DEFINES);
+                else if (mode == DrawMode::WEIGHTED_BLENDED)
+                    program = command.material->shader->getVariant(INSTANCED_SHADER_DEFINES WEIGHTED_BLENDED_SHADER_DEFINES);
+                else if (getUniforms(command.material->shader).lit)
+                {
+                    // The lit shaders are specialized for the light counts & types of the frame (if the variant compiles)
+                    if (ShaderProgram *specialized = command.material->shader->getVariant(instancedLightDefines[command.bakedLighting]))
+                        program = specialized;
+                }
+                if (!program)
+                {
+                    first += count;
+                    continue;
+                }
+                setupMaterial(command.material, depthOnly ? depthOnly : program, mode, depthOnly != nullptr);
+                command.mesh->setInstanceAttributes(instanceBuffer, (instanceBase + first) * sizeof(InstanceData), sizeof(InstanceData));
+                command.mesh->drawInstanced(count);
+            }
+            else
+            {
+                // If the shader has no instanced variant, we fall back to drawing the commands one by one
+                for (size_t index = first; index < first + count; index++)
+                {
+                    const RenderCommand &single = commands[index];
+                    // If the depth only variant fails to compile, the depth pre-pass falls back to the material shader
+                    ShaderProgram *program = single.material->shader, *depthOnly = nullptr;
+                    if (mode == DrawMode::DEPTH_ONLY)
+                        depthOnly = program->getVariant("", DEPTH_ONLY_FRAGMENT_SHADER);
+                    else if (mode == DrawMode::GBUFFER)
+                        program = program->getVariant(GBUFFER_SHADER_DEFINES);
+                    else if (mode == DrawMode::WEIGHTED_BLENDED)
+                        program = program->getVariant(WEIGHTED_BLENDED_SHADER_DEFINES);
+                    else if (getUniforms(program).lit)
+                    {
+                        if (ShaderProgram *specialized = program->getVariant(lightDefines[single.bakedLighting]))
+                            program = specialized;
+                    }
+                    if (depthOnly)
+                        program = depthOnly;
+                    // The commands whose shader has no G-buffer variant cannot be drawn by the deferred renderer
+                    if (!program)
+                        continue;
+                    setupMaterial(single.material, program, mode, depthOnly != nullptr);
+                    const RendererUniforms &uniforms = getUniforms(program);
+                    // The lit shaders need the model matrix (and its inverse transpose for the normals)
+                    if (uniforms.M >= 0)
+                        program->set(uniforms.M, single.localToWorld);
+                    if (uniforms.M_IT >= 0)
+                        program->set(uniforms.M_IT, glm::transpose(glm::inverse(single.localToWorld)));
+                    program->set(uniforms.transform, VP * single.localToWorld);
+                    single.mesh->draw();
+                }
+            }
+            first += count;
+        }
+    }
+
+    std::uint64_t ForwardRenderer::makeSortKey(RenderPass pass, const RenderCommand &command, float depth){
+        const std::uint64_t depthMax = (std::uint64_t(1) << SORT_KEY_DEPTH_BITS) - 1;
+        std::uint64_t quantizedDepth = (std::uint64_t)(glm::clamp(depth, 0.0f, 1.0f) * depthMax);
+        std::uint64_t shader = command.material->shader->getProgram() & 0x3FF;
+        std::uint64_t material = command.material->id & 0x3FFF;
+        std::uint64_t mesh = command.mesh->getId() & 0x3FFF;
+        std::uint64_t key = (std::uint64_t)pass << 62;
+        if (pass == RenderPass::TRANSPARENT_PASS)
+            key |= ((depthMax - quantizedDepth) << 38) | (shader << 28) | (material << 14) | mesh;
+        else
+            key |= (shader << 52) | (material << 38) | (mesh << 24) | quantizedDepth;
+        return key;
+    }
+
+    void ForwardRenderer::updateRetainedCommands(World *world)
+    {
+        if (world != retainedWorld || MeshRendererComponent::instancesVersion != retainedVersion)
+        {
+            // Some mesh renderers were added or removed, so we rebuild the list while keeping the commands of the ones that still exist
+            std::unordered_map<MeshRendererComponent *, size_t> previous;
+            if (world == retainedWorld)
+                for (size_t index = 0; index < retainedCommands.size(); index++)
+                    previous[retainedCommands[index].meshRenderer] = index;
+            std::vector<RetainedCommand> commands;
+            commands.reserve(MeshRendererComponent::instances.size());
+            std::vector<std::uint8_t> kept(retainedCommands.size(), 0);
+            for (auto meshRenderer : MeshRendererComponent::instances)
+            {
+                Entity *owner = meshRenderer->getOwner();
+                if (!owner || owner->getWorld() != world)
+                    continue;
+                // A reused address is harmless since the command is still checked against the current transforms, mesh & material
+                if (auto it = previous.find(meshRenderer); it != previous.end())
+                {
+                    commands.push_back(std::move(retainedCommands[it->second]));
+                    kept[it->second] = 1;
+                }
+                else
+                {
+                    commands.emplace_back();
+                    commands.back().meshRenderer = meshRenderer;
+                }
+            }
+            // The queries of the commands that were dropped go back to the occlusion culler
+            for (size_t index = 0; index < retainedCommands.size(); index++)
+                if (!kept[index])
+                    occlusionCuller.release(retainedCommands[index].occlusion);
+            retainedCommands.swap(commands);
+            // The order of the commands changed so the sphere list is refilled
+            retainedBounds.resize(retainedCommands.size());
+            for (size_t index = 0; index < retainedCommands.size(); index++)
+                retainedBounds.set(index, retainedCommands[index].boundsCenter, retainedCommands[index].boundsRadius);
+            retainedWorld = world;
+            retainedVersion = MeshRendererComponent::instancesVersion;
+        }
+
+        cullingStatistics.updated = 0;
+        for (size_t index = 0; index < retainedCommands.size(); index++)
+        {
+            RetainedCommand &retained = retainedCommands[index];
+            MeshRendererComponent *meshRenderer = retained.meshRenderer;
+            Entity *owner = meshRenderer->getOwner();
+
+            // Compare the current transforms of the entity and its ancestors with the ones the command was built from
+            bool changed = retained.command.mesh != meshRenderer->mesh || retained.command.material != meshRenderer->material;
+            size_t depth = 0;
+            for (Entity *entity = owner; entity && !changed; entity = entity->parent, depth++)
+                changed = depth >= retained.transforms.size() || retained.transforms[depth] != entity->localTransform;
+            if (!changed && depth == retained.transforms.size())
+                continue;
+
+            retained.transforms.clear();
+            for (Entity *entity = owner; entity; entity = entity->parent)
+                retained.transforms.push_back(entity->localTransform);
+            RenderCommand &command = retained.command;
+            command.localToWorld = owner->getLocalToWorldMatrix();
+            command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
+            command.mesh = meshRenderer->mesh;
+            command.material = meshRenderer->material;
+            command.bakedLighting = meshRenderer->bakedLighting;
+            // The sphere radius is scaled by the largest scale of the model matrix so that it always contains the mesh
+            retained.boundsCenter = command.center;
+            retained.boundsRadius = 0.0f;
+            if (command.mesh)
+            {
+                glm::mat4 &M = command.localToWorld;
+                float scale = std::max(glm::length(glm::vec3(M[0])), std::max(glm::length(glm::vec3(M[1])), glm::length(glm::vec3(M[2]))));
+                retained.boundsCenter = glm::vec3(M * glm::vec4(command.mesh->getBoundsCenter(), 1.0f));
+                retained.boundsRadius = command.mesh->getBoundsRadius() * scale;
+                glm::vec3 boxMin = command.mesh->getBoundsMin(), boxMax = command.mesh->getBoundsMax();
+                retained.occlusionBox = M * OcclusionCuller::boxTransform(boxMin, boxMax);
+                retained.occlusionRadius = glm::length((boxMax - boxMin) * 0.5f) * scale;
+            }
+            retainedBounds.set(index, retained.boundsCenter, retained.boundsRadius);
+            cullingStatistics.updated++;
+        }
+    }
+
+    void ForwardRenderer::drawForwardOpaqueCommands(size_t first, const glm::mat4 &VP)
+    {
+        const RenderCommand *commands = opaqueCommands.data() + first;
+        size_t count = opaqueCommands.size() - first;
+        if (depthPrepassEnabled)
+        {
+            // The depth of the opaque commands is written first with a trivial fragment shader,
+            // then each pixel is shaded only by the fragment that ended up closest
+            drawCommands(commands, count, first, VP, DrawMode::DEPTH_ONLY);
+            drawCommands(commands, count, first, VP, DrawMode::DEPTH_EQUAL);
+        }
+        else
+            drawCommands(commands, count, first, VP);
+    }
+
+    bool ForwardRenderer::supportsInstancing(ShaderProgram *shader)
+    {
+        if (auto it = instancingSupport.find(shader); it != instancingSupport.end())
+            return it->second;
+        // A shader that ignores the define still compiles (and would draw every instance with the same transform),
+        // so the variant must also read the instance model matrix
+        ShaderProgram *variant = shader->getVariant(INSTANCED_SHADER_DEFINES);
+        return instancingSupport[shader] = variant && glGetAttribLocation(variant->getProgram(), "instance_M") >= 0;
+    }
+
+    bool ForwardRenderer::supportsWeightedBlended(ShaderProgram *shader)
+    {
+        if (auto it = weightedBlendedSupport.find(shader); it != weightedBlendedSupport.end())
+            return it->second;
+        // A shader that ignores the define still compiles, so the variant must also write the weight target
+        ShaderProgram *variant = shader->getVariant(WEIGHTED_BLENDED_SHADER_DEFINES);
+        return weightedBlendedSupport[shader] = variant && glGetFragDataLocation(variant->getProgram(), "oit_weight") >= 0;
+    }
+
+    void ForwardRenderer::drawTransparentCommands(const glm::mat4 &VP)
+    {
+        // The weighted blended commands are at the front of the queue since their pass comes first in the sort key
+        size_t weightedCount = 0;
+        while (weightedCount < transparentCommands.size() &&
+               (RenderPass)(transparentCommands[weightedCount].sortKey >> 62) == RenderPass::WEIGHTED_BLENDED_PASS)
+            weightedCount++;
+
+        if (weightedCount > 0)
+        {
+            // The accumulation starts with a revealage of 1 (the scene behind is fully visible)
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, weightedBlendedFrameBuffer);
+            glColorMask(true, true, true, true);
+            PipelineState::invalidateCache();
+            const GLfloat clearAccumulation[] = {0.0f, 0.0f, 0.0f, 1.0f};
+            const GLfloat clearWeight[] = {0.0f, 0.0f, 0.0f, 0.0f};
+            glClearBufferfv(GL_COLOR, 0, clearAccumulation);
+            glClearBufferfv(GL_COLOR, 1, clearWeight);
+            drawCommands(transparentCommands.data(), weightedCount, opaqueCommands.size(), VP, DrawMode::WEIGHTED_BLENDED);
+
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, getTargetFramebuffer());
+            compositePipelineState.setup();
+            compositeShader->use();
+            glActiveTexture(GL_TEXTURE0);
+            accumulationTarget->bind();
+            glBindSampler(0, 0);
+            glActiveTexture(GL_TEXTURE1);
+            weightTarget->bind();
+            glBindSampler(1, 0);
+            glBindVertexArray(postProcessVertexArray);
+            GeometryBuffer::invalidateBinding();
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+
+        // The transparent commands whose shader has no weighted blended variant are still drawn back-to-front
+        drawCommands(transparentCommands.data() + weightedCount, transparentCommands.size() - weightedCount,
+                     opaqueCommands.size() + weightedCount, VP);
+    }
+
+    void ForwardRenderer::limitLights(const glm::vec3 &cameraPosition, size_t maxLights)
+    {
+        // The directional lights reach everything so they are always kept in front of the others
+        auto others = std::partition(lights.begin(), lights.end(), [](const LightComponent *light)
+                                     { return light->lightType == DIRECTIONAL; });
+        if ((size_t)(lights.end() - others) <= maxLights)
+            return;
+        std::nth_element(others, others + maxLights, lights.end(), [&](const LightComponent *a, const LightComponent *b)
+                         { return glm::dot(a->position - cameraPosition, a->position - cameraPosition) <
+                                  glm::dot(b->position - cameraPosition, b->position - cameraPosition); });
+        lights.erase(others + maxLights, lights.end());
     }
 
     void ForwardRenderer::render(World *world, bool increaseSpeedEffect , bool collisionEffect ){
+        TRACE_SCOPE("Render");
+        auto cpuStartTime = std::chrono::steady_clock::now();
+        // Start counting the pipeline state changes of this frame
+        PipelineState::newFrame();
+
+        // The knobs picked by the quality governor (the default ones if it is disabled)
+        // The render scale needs the scene targets to draw into a part of them, so it only applies with a postprocess chain
+        const QualityLevel &quality = qualityGovernor.getLevel();
+        renderSize = windowSize;
+        if (postprocessChain.isEnabled())
+            renderSize = glm::max(glm::ivec2(glm::vec2(windowSize) * quality.renderScale), glm::ivec2(1));
+        postprocessChain.setPyramidBias(2 - quality.postprocessQuality);
 
         // First of all, we search for a camera and for all the mesh renderers
         CameraComponent *camera = nullptr;
     opaqueCommands.clear();
     transparentCommands.clear();
+    // The lights are collected again every frame
+    lights.clear();
 
-    glm::vec3 playerPosition = player->localTransform.position;
+    glm::vec3 playerPosition = player ? player->localTransform.position : glm::vec3(0.0f);
     for (auto entity : world->getEntities())
     {
         // If we hadn't found a camera yet, we look for a camera in this entity
@@ -157,27 +560,8 @@ namespace our
         if (entity->hidden)
             continue;
 
-        // If this entity has a mesh renderer component
-        if (auto meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer)
-        {
-            // We construct a command from it
-            RenderCommand command;
-            command.localToWorld = meshRenderer->getOwner()->getLocalToWorldMatrix();
-            command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
-            command.mesh = meshRenderer->mesh;
-            command.material = meshRenderer->material;
-            // if it is transparent, we add it to the transparent commands list
-            if (command.material->transparent)
-            {
-                transparentCommands.push_back(command);
-            }
-            else
-            {
-                // Otherwise, we add it to the opaque command list
-                opaqueCommands.push_back(command);
-            }
-        }
         // get the light component from all entities
+        // (the baked lights are kept too, only the BAKED_LIGHTING variant skips them since they are already in its vertex colors)
         if (auto light = entity->getComponent<LightComponent>(); light)
         {
             if (light)  
@@ -196,30 +580,111 @@ namespace our
         // If there is no camera, we return (we cannot render without a camera)
         if (camera == nullptr)
             return;
+
+        // The query that was issued FRAME_TIME_QUERY_COUNT frames ago is read (if it is done) before it is reused for this frame
+        if (frameTimeQueries[0])
+        {
+            GLuint query = frameTimeQueries[frameTimeQueryIndex];
+            GLint available = 0;
+            if (frameTimeQueryIssued[frameTimeQueryIndex])
+                glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+                gpuFrameTime = elapsed * 1e-6f;
+            }
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            frameTimeQueryIssued[frameTimeQueryIndex] = true;
+        }
         // TODO: (Req 9) Modify the following line such that "cameraForward" contains a vector pointing the camera forward direction
         //  HINT: See how you wrote the CameraComponent::getViewMatrix, it should help you solve this one
         // CameraComponent::getViewMatrix();
         glm::vec4 forward_camera = glm::vec4(0.0f, 0.0f, -1.0f, 0.0f); // Forward in camera space
         glm::vec3 cameraForward = glm::normalize(glm::vec3(camera->getOwner()->getLocalToWorldMatrix() * forward_camera));
 
-        // glm::vec3 cameraForward = glm::vec3(0.0, 0.0, -1.0f);
-        std::sort(transparentCommands.begin(), transparentCommands.end(), [cameraForward](const RenderCommand &first, const RenderCommand &second)
-                  {
-            //TODO: (Req 9) Finish this function
-            // HINT: the following return should return true "first" should be drawn before "second". 
-            // the dot product between first's center or second's center and "cameraForward" represent the distance between them.
-            // The larger the distance, the closer they are drawn.
-            float dist1 = glm::dot(cameraForward, first.center);
-            float dist2 = glm::dot(cameraForward, second.center);
+        glm::vec3 cameraPosition = camera->getOwner()->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1);
 
-            // Return true if 'first' is farther away than 'second'     
-            return dist1 > dist2; });
+        if (quality.maxLights > 0)
+            limitLights(cameraPosition, quality.maxLights);
 
         // TODO: (Req 9) Get the camera ViewProjection matrix and store it in VP
         glm::mat4 VP = camera->getProjectionMatrix(windowSize) * camera->getViewMatrix();
 
+        // The mesh renderer commands are retained between frames and only the ones that changed are rebuilt
+        {
+            TRACE_SCOPE("Update commands");
+            updateRetainedCommands(world);
+        }
+
+        {
+            TRACE_SCOPE("Cull");
+            // The commands whose bounding sphere is completely outside the view frustum are dropped before they enter the queues
+            cullingStatistics.submitted = 0;
+            cullingStatistics.culled = 0;
+            if (frustumCullingEnabled)
+                retainedBounds.cull(Frustum::fromViewProjection(VP), commandVisibility);
+            else
+                commandVisibility.assign(retainedCommands.size(), 1);
+            cullingStatistics.occluded = 0;
+            occlusionTested.clear();
+            for (size_t index = 0; index < retainedCommands.size(); index++)
+            {
+                RetainedCommand &retained = retainedCommands[index];
+                // The hidden entities and the commands without a mesh or a material are not submitted at all
+                bool submitted = !retained.meshRenderer->getOwner()->hidden && retained.command.mesh && retained.command.material;
+                if (submitted)
+                    cullingStatistics.submitted++;
+                if (!submitted || !commandVisibility[index])
+                {
+                    // The old results mean nothing once the object is back in view, so it starts again as visible
+                    if (retained.occlusion.pending || retained.occlusion.occluded)
+                        occlusionCuller.release(retained.occlusion);
+                    if (submitted)
+                        cullingStatistics.culled++;
+                    continue;
+                }
+                // If the camera is (almost) inside the box, the box gets clipped by the near plane so it cannot be tested
+                if (occlusionCullingEnabled &&
+                    glm::distance(cameraPosition, retained.boundsCenter) > retained.occlusionRadius + 2.0f * camera->near)
+                {
+                    occlusionTested.push_back(index);
+                    if (occlusionCuller.collect(retained.occlusion))
+                    {
+                        cullingStatistics.occluded++;
+                        continue;
+                    }
+                }
+                // if it is transparent, we add it to the transparent commands list
+                if (retained.command.material->transparent)
+                    transparentCommands.push_back(retained.command);
+                else
+                    // Otherwise, we add it to the opaque command list
+                    opaqueCommands.push_back(retained.command);
+            }
+        }
+
+        {
+            TRACE_SCOPE("Sort");
+            // Both queues are sorted by a packed key (see "makeSortKey") using a radix sort
+            // The opaque commands are grouped by shader, material and mesh to minimize the state changes and then drawn front-to-back,
+            // while the transparent commands are drawn back-to-front.
+            // The depth is the distance along the camera forward which is divided by the far plane distance to quantize it
+            float inverseFar = 1.0f / camera->far;
+            for (auto &command : opaqueCommands)
+                command.sortKey = makeSortKey(getOpaquePass(command), command, glm::dot(cameraForward, command.center - cameraPosition) * inverseFar);
+            for (auto &command : transparentCommands)
+            {
+                RenderPass pass = weightedBlendedEnabled && supportsWeightedBlended(command.material->shader) ? RenderPass::WEIGHTED_BLENDED_PASS : RenderPass::TRANSPARENT_PASS;
+                command.sortKey = makeSortKey(pass, command, glm::dot(cameraForward, command.center - cameraPosition) * inverseFar);
+            }
+            auto getSortKey = [](const RenderCommand &command) { return command.sortKey; };
+            radixSort(opaqueCommands, sortScratch, getSortKey);
+            radixSort(transparentCommands, sortScratch, getSortKey);
+        }
+
         // TODO: (Req 9) Set the OpenGL viewport using viewportStart and viewportSize
-        glViewport(0.0f, 0.0f, windowSize.x, windowSize.y);
+        glViewport(0.0f, 0.0f, renderSize.x, renderSize.y);
 
         // TODO: (Req 9) Set the clear color to black and the clear depth to 1
         glClearDepth(1.0f);
@@ -228,9 +693,12 @@ namespace our
         // TODO: (Req 9) Set the color mask to true and the depth mask to true (to ensure the glClear will affect the framebuffer)
         glColorMask(true, true, true, true);
         glDepthMask(true);
+        // The masks were changed behind the back of the pipeline state cache (and ImGui may have touched the rest)
+        PipelineState::invalidateCache();
+        GeometryBuffer::invalidateBinding();
 
-        // If there is a postprocess material, bind the framebuffer
-        if (postprocessMaterial)
+        // If there is a postprocess chain, bind the framebuffer
+        if (postprocessChain.isEnabled())
         {
             // TODO: (Req 11) bind the framebuffer
             glBindFramebuffer(GL_DRAW_FRAMEBUFFER,postprocessFrameBuffer);
@@ -244,129 +712,120 @@ namespace our
         // TODO: (Req 9) Draw all the opaque commands
         //  Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
         
-        for (auto &command : opaqueCommands)
         {
-            command.material->setup();
-            //check if this has light material or not 
-            if(auto material_light=dynamic_cast<LightingMaterial*>(command.material);material_light)
+            TRACE_SCOPE("Upload frame data");
+            // Everything shared by the draws of this frame is written once into the uniform buffers
+            // so that the lit draws only need to send their model matrices
+            // The lights are assigned to the clusters of the frustum so that each fragment only loops over the lights that reach it
+            lightClusters.update(lights, VP, cameraPosition, cameraForward, camera->near, camera->far);
+            lightClusters.bind();
+            // The lit shaders are drawn with the variant specialized for the lights of this frame
+            // (and the meshes with baked light also read it from their vertex colors)
+            lightDefines[0] = lightClusters.getShaderDefines();
+            lightDefines[1] = lightDefines[0] + BAKED_LIGHTING_SHADER_DEFINES;
+            instancedLightDefines[0] = INSTANCED_SHADER_DEFINES + lightDefines[0];
+            instancedLightDefines[1] = INSTANCED_SHADER_DEFINES + lightDefines[1];
+
+            FrameBlock frame{};
+            frame.VP = VP;
+            frame.camera_position = cameraPosition;
+            frame.directional_light_count = lightClusters.getDirectionalLightCount();
+            frame.camera_forward = cameraForward;
+            frame.global_light_count = lightClusters.getGlobalLightCount();
+            frame.cluster_tile_size = glm::vec2(renderSize) / glm::vec2(CLUSTER_COUNT_X, CLUSTER_COUNT_Y);
+            frame.cluster_z_scale = lightClusters.getZScale();
+            frame.cluster_z_bias = lightClusters.getZBias();
+            frame.sky.top = glm::vec3(0.0f, 0.1f, 0.5f);
+            frame.sky.horizon = glm::vec3(0.3f, 0.3f, 0.3f);
+            frame.sky.bottom = glm::vec3(0.1f, 0.1f, 0.1f);
+            frameUniforms->update(&frame, sizeof(FrameBlock));
+            frameUniforms->bind(UNIFORM_BLOCK_FRAME);
+
+            // The model matrices of all the commands are streamed to the instance buffer in one upload
+            // The inverse transpose is only computed for the shaders that use it
+            if (instancingEnabled)
             {
+                instanceData.resize(opaqueCommands.size() + transparentCommands.size());
+                size_t index = 0;
+                for (auto *commands : {&opaqueCommands, &transparentCommands})
+                    for (auto &command : *commands)
+                    {
+                        InstanceData &instance = instanceData[index++];
+                        instance.M = command.localToWorld;
+                        if (getUniforms(command.material->shader).M_IT >= 0)
+                            instance.M_IT = glm::transpose(glm::inverse(command.localToWorld));
+                    }
+                glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+                glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(InstanceData), instanceData.data(), GL_STREAM_DRAW);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+        }
 
+        {
+            GpuProfileScope scope("Opaque");
+            TRACE_SCOPE("Opaque");
+            drawOpaqueCommands(VP);
+        }
 
-                //send the data to fragment shader 
-                material_light->shader->set("sky.top", glm::vec3    (0.0f, 0.1f, 0.5f));
-                material_light->shader->set("sky.horizon", glm::vec3(0.3f, 0.3f, 0.3f));
-                material_light->shader->set("sky.bottom", glm::vec3 (0.1f, 0.1f, 0.1f));
-
-                material_light->shader->set("light_count", int(lights.size()));
-
-                material_light->shader->set("VP", VP);
-                material_light->shader->set("M_IT",glm::transpose(glm::inverse(command.localToWorld)));
-                glm::vec3 cameraPosition = camera->getOwner()->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1);
-
-                material_light->shader->set("camera_position",cameraPosition);
-                material_light->shader->set("M", command.localToWorld);
-                
-                // std::cout<<"lights.size()"<<lights.size()<<std::endl;
-                for(int i=0;i<lights.size();i++)
-                {
-                    material_light->shader->set("lights[" + std::to_string(i) + "].position", lights[i]->position);
-                    // std::cout<<"lights[i]->position ( "<<lights[i]->position.r<<" ,"<<lights[i]->position.g<<" ,"<<lights[i]->position.b<<" )"<<std::endl;
-                    material_light->shader->set("lights["+std::to_string(i)+"].type",lights[i]->lightType);
-                    material_light->shader->set("lights["+std::to_string(i)+"].direction",lights[i]->direction);
-                    material_light->shader->set("lights["+std::to_string(i)+"].color",lights[i]->color);
-                    material_light->shader->set("lights["+std::to_string(i)+"].attenuation",lights[i]->attenuation);
-                    // if(lights[i]->lightType==2)
-                    material_light->shader->set("lights["+std::to_string(i)+"].cone_angles",lights[i]->cone_angles);
-                    // std::cout << "angles (" << lights[i]->cone_angles.x << " ," << lights[i]->cone_angles.y << " )" << std::endl;
-                }
-            }
-            command.material->shader->set("transform", VP * command.localToWorld);
-            command.mesh->draw();
+        // The depth buffer now has every opaque object that was drawn, so the bounding boxes are tested against it
+        // The results are read in the next frames (see "OcclusionCuller::collect") so this never waits for the GPU
+        if (occlusionCullingEnabled && !occlusionTested.empty())
+        {
+            GpuProfileScope scope("Occlusion queries");
+            TRACE_SCOPE("Occlusion queries");
+            occlusionCuller.begin();
+            for (size_t index : occlusionTested)
+                occlusionCuller.query(retainedCommands[index].occlusion, VP * retainedCommands[index].occlusionBox);
         }
 
-        // If there is a sky material, draw the sky
-        if (this->skyMaterial)
+        // If there is a sky, draw it
+        if (skyShader)
         {
-            // TODO: (Req 10) setup the sky material
-            skyMaterial->setup();
-
-            // TODO: (Req 10) Get the camera position
-            glm::vec3 cameraPosition = camera->getOwner()->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1);
-            // glm::vec3 cameraPosition = glm::vec3(0.0f, 0.0f, 0.0f);
-
-            // TODO: (Req 10) Create a model matrix for the sky such that it always follows the camera (sky sphere center = camera position)
-            glm::mat4 skyModelMatrix = translate(glm::mat4(1.0f), cameraPosition);
-            // M matrix is used to be in world space
-
-            // TODO: (Req 10) We want the sky to be drawn behind everything (in NDC space, z=1)
-            //  We can acheive the is by multiplying by an extra matrix after the projection but what values should we put in it?
-            glm::mat4 alwaysBehindTransform = glm::mat4(
-                1.0f, 0.0f, 0.0f, 0.0f,
-                0.0f, 1.0f, 0.0f, 0.0f,
-                0.0f, 0.0f, 0.0f, 0.0f,
-                0.0f, 0.0f, 1.0f, 1.0f);
-            // first set z to be 0   ,  then translate it to 1 while keeping the x, y unchanged
-            // 1.0f, 0.0f, 0.0f, 0.0f   1.0f, 0.0f, 0.0f, 0.0f  
-            // 0.0f, 1.0f, 0.0f, 0.0f x 0.0f, 1.0f, 0.0f, 0.0f  
-            // 0.0f, 0.0f, 0.0f, 1.0f   0.0f, 0.0f, 0.0f, 0.0f  
-            // 0.0f, 0.0f, 0.0f, 1.0f   0.0f, 0.0f, 0.0f, 1.0f 
-
-            // TODO: (Req 10) set the "transform" uniform
-            skyMaterial->shader->set("transform", alwaysBehindTransform * VP * skyModelMatrix);
-            // first multiply by M to be in World space
-            // multiply by V to be in View space
-            // multiply by P to be in HomogenusClip space (used by shaders to draw)
-            // transform the sky to the back
-
-            // TODO: (Req 10) draw the sky sphere
-            skySphere->draw();
+            GpuProfileScope scope("Sky");
+            TRACE_SCOPE("Sky");
+            // The first frame waits for the cubemap conversion if it is not done yet so that the sky never pops in
+            if (!skyTexture && skyFaces.valid())
+                skyTexture = texture_utils::cubemap(skyFaces.get());
+            if (skyTexture)
+            {
+                skyPipelineState.setup();
+                skyShader->use();
+                skyShader->set(skyInverseVPLocation, glm::inverse(VP));
+                skyShader->set(skyCameraPositionLocation, cameraPosition);
+                glActiveTexture(GL_TEXTURE0);
+                skyTexture->bind();
+                skySampler->bind(0);
+                glBindVertexArray(skyVertexArray);
+                GeometryBuffer::invalidateBinding();
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
         }
         // TODO: (Req 9) Draw all the transparent commands
         //  Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
-        for (auto &command : transparentCommands)
         {
-            command.material->setup();
-            command.material->shader->set("transform", VP * command.localToWorld);
-            command.mesh->draw();
+            GpuProfileScope scope("Transparent");
+            TRACE_SCOPE("Transparent");
+            drawTransparentCommands(VP);
         }
 
-        // If there is a postprocess material, apply postprocessing
-        if (postprocessMaterial)
+        // If there is a postprocess chain, apply postprocessing
+        if (postprocessChain.isEnabled())
         {
+            GpuProfileScope scope("Postprocess");
+            TRACE_SCOPE("Postprocess");
             // TODO: (Req 11) Return to the default framebuffer
+            // The chain fades the effects in and out by the speed and collision flags
+            // and its last effect draws into the default framebuffer
+            postprocessChain.apply(colorTarget, postprocessFrameBuffer, renderSize, windowSize, increaseSpeedEffect, collisionEffect);
+        }
 
-            ShaderProgram *postprocessShader = new ShaderProgram();
-            // attach the vertex shader
-            postprocessShader->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
-
-            // attach the fragment shader based on the effect type (fish eye or blur or power up or radial blur or vignette)
-            if (increaseSpeedEffect)
-                postprocessShader->attach("assets/shaders/postprocess/radial-blur.frag", GL_FRAGMENT_SHADER);
-            else if (collisionEffect)
-                postprocessShader->attach("assets/shaders/postprocess/collision.frag", GL_FRAGMENT_SHADER);
-            else
-                postprocessShader->attach("assets/shaders/postprocess/vignette.frag", GL_FRAGMENT_SHADER);
-
-            // link the shader program
-            postprocessShader->link();
-
-            // create a postprocess material for the postprocess shader
-            postprocessMaterial->shader = postprocessShader;
-
-            glBindFramebuffer(GL_DRAW_FRAMEBUFFER,0); //unbind our frame buffer to return to the default one
-            // TODO: (Req 11) Setup the postprocess material and draw the fullscreen triangle
-            postprocessMaterial->setup();
-            //to draw the triangle we need to: 
-            glBindVertexArray(postProcessVertexArray); //1-bind the vertex array object to the ID postProcessVertexArray
-            //It tells OpenGL how to interpret vertex data stored in vertex array objects during rendering
-            glDrawArrays(GL_TRIANGLES,0,3);
-            //This function call tells OpenGL to draw triangles using vertex data from currently bound vertex array object
-            //parameters:
-            //GL_TRIANGLES-->the primitive type to draw
-            //0-->the starting index of the vertex array
-            //3-->the number of vertices to render 
-
-
+        // The governor compares the time of this frame on the CPU and of an older frame on the GPU with its target
+        if (frameTimeQueries[0])
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            frameTimeQueryIndex = (frameTimeQueryIndex + 1) % FRAME_TIME_QUERY_COUNT;
+            cpuFrameTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - cpuStartTime).count();
+            qualityGovernor.update(cpuFrameTime, gpuFrameTime);
         }
     }
 }
\ No newline at end of file
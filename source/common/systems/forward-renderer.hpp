@@ -6,9 +6,20 @@
 #include "../components/light.hpp"
 #include "../asset-loader.hpp"
 #include "../ecs/entity.hpp"
+#include "../shader/uniform-buffer.hpp"
+#include "radix-sort.hpp"
+#include "frustum-culling.hpp"
+#include "occlusion-culling.hpp"
+#include "light-clusters.hpp"
+#include "postprocess-chain.hpp"
+#include "quality-governor.hpp"
+#include "../texture/texture-utils.hpp"
 #include <glad/gl.h>
 #include <vector>
 #include <algorithm>
+#include <unordered_map>
+#include <future>
+#include <chrono>
 
 namespace our
 {
@@ -21,38 +32,250 @@ namespace our
         glm::vec3 center;
         Mesh* mesh;
         Material* material;
+        // If true, the mesh holds baked light in its vertex colors (see "LightBaker")
+        bool bakedLighting;
+        // The key by which the render queues are sorted (see "makeSortKey")
+        std::uint64_t sortKey;
+    };
+
+    // The number of frames after which the GPU time of a frame is read back (so that reading it never waits for the GPU)
+    #define FRAME_TIME_QUERY_COUNT 4
+
+    // The sort key packs (from the most significant bit) the following fields:
+    // Opaque:      | pass (2) | shader (10) | material (14) | mesh (14) | depth (24) | (the deferred and weighted blended passes use the same layout)
+    // Transparent: | pass (2) | inverted depth (24) | shader (10) | material (14) | mesh (14) |
+    // So opaque draws are grouped by state and then drawn front-to-back (for early depth rejection),
+    // while transparent draws are drawn back-to-front which is needed for correct blending
+    // (unless they are drawn with weighted blended OIT, which does not depend on the order so they are grouped by state too)
+    #define SORT_KEY_DEPTH_BITS 24
+    // The deferred pass comes first so that the commands drawn into the G-buffer (see "DeferredRenderer")
+    // end up at the front of the opaque queue, and the weighted blended pass comes before the sorted transparent pass
+    enum class RenderPass : std::uint64_t {
+        DEFERRED_PASS = 0,
+        OPAQUE_PASS = 1,
+        WEIGHTED_BLENDED_PASS = 2,
+        TRANSPARENT_PASS = 3
+    };
+
+    // The number of commands that were submitted to the renderer (the mesh renderers of the entities that are not hidden)
+    // and how many of them were culled by the view frustum in the last frame
+    // "occluded" is the number of commands inside the frustum that were skipped since their occlusion query found them hidden
+    // "updated" is the number of retained commands that had to be rebuilt because their mesh renderer changed
+    struct CullingStatistics {
+        size_t submitted = 0;
+        size_t culled = 0;
+        size_t occluded = 0;
+        size_t updated = 0;
+    };
+
+    // A render command that the renderer keeps between frames for a mesh renderer (see "ForwardRenderer::updateRetainedCommands")
+    struct RetainedCommand {
+        MeshRendererComponent* meshRenderer;
+        RenderCommand command;
+        // The local transforms of the entity and its ancestors when the command was built
+        // The command is only rebuilt when one of them (or the mesh or the material) changes
+        std::vector<Transform> transforms;
+        // The world space bounding sphere of the command
+        glm::vec3 boundsCenter = glm::vec3(0.0f);
+        float boundsRadius = 0.0f;
+        // The matrix that maps the occlusion culler cube to the mesh bounding box in world space
+        // and the radius of a sphere around that box (centered at the same point)
+        glm::mat4 occlusionBox = glm::mat4(1.0f);
+        float occlusionRadius = 0.0f;
+        OcclusionState occlusion;
+    };
+
+    // The data of a single instance streamed to the instance buffer (see "Mesh::setInstanceAttributes")
+    struct InstanceData {
+        glm::mat4 M;
+        glm::mat4 M_IT;
+    };
+
+    // The defines used to compile the instanced variant of a material shader
+    #define INSTANCED_SHADER_DEFINES "#define INSTANCED\n"
+    // The fragment shader that replaces the material fragment shader in the depth pre-pass
+    // Since the pre-pass links the material vertex shader with another fragment shader, the positions of both programs
+    // only match exactly (as GL_EQUAL depth testing requires) if the vertex shaders declare "invariant gl_Position"
+    #define DEPTH_ONLY_FRAGMENT_SHADER "assets/shaders/depth-only.frag"
+    // The defines used to compile the variant of a material shader that writes the G-buffer (see "DeferredRenderer")
+    #define GBUFFER_SHADER_DEFINES "#define GBUFFER\n"
+    // The defines used to compile the variant of a lit shader that adds the light baked in the vertex colors (see "LightBaker")
+    #define BAKED_LIGHTING_SHADER_DEFINES "#define BAKED_LIGHTING\n"
+    // The defines used to compile the variant of a transparent material shader that writes the weighted blended OIT targets
+    #define WEIGHTED_BLENDED_SHADER_DEFINES "#define WEIGHTED_BLENDED_OIT\n"
+    // The largest size of a face of the sky cubemap
+    #define MAX_SKY_FACE_SIZE 1024
+
+    // How "ForwardRenderer::drawCommands" draws the commands:
+    // COLOR draws them normally, DEPTH_ONLY only writes their depth (the depth pre-pass),
+    // DEPTH_EQUAL shades them without writing depth, only where the depth pre-pass left their own depth
+    // GBUFFER writes their surface into the G-buffer of the deferred renderer
+    // and WEIGHTED_BLENDED adds their weighted color into the weighted blended OIT targets
+    enum class DrawMode {
+        COLOR,
+        DEPTH_ONLY,
+        DEPTH_EQUAL,
+        GBUFFER,
+        WEIGHTED_BLENDED
+    };
+
+    // The uniform locations that the renderer sends every draw for a given shader
+    // They are resolved once per shader (see "ForwardRenderer::getUniforms") so that the draw loop
+    // never builds uniform names or hashes them
+    // Everything else the lit shaders need is in the per-frame uniform blocks
+    // "lit" is true for the shaders that read the lights (they are specialized for the lights of the frame, see "LightClusters")
+    struct RendererUniforms {
+        GLint transform, M, M_IT;
+        bool lit;
     };
 
     // A forward renderer is a renderer that draw the object final color directly to the framebuffer
     // In other words, the fragment shader in the material should output the color that we should see on the screen
     // This is different from more complex renderers that could draw intermediate data to a framebuffer before computing the final color
     // In this project, we only need to implement a forward renderer
+    // The renderer can be extended (see "DeferredRenderer") by changing how the opaque commands are drawn
     class ForwardRenderer {
+    protected:
         // These window size will be used on multiple occasions (setting the viewport, computing the aspect ratio, etc.)
         glm::ivec2 windowSize;
         // These are two vectors in which we will store the opaque and the transparent commands.
         // We define them here (instead of being local to the "render" function) as an optimization to prevent reallocating them every frame
         std::vector<RenderCommand> opaqueCommands;
         std::vector<RenderCommand> transparentCommands;
-        // Objects used for rendering a skybox
-        Mesh* skySphere;
-        TexturedMaterial* skyMaterial;
-        // Objects used for Postprocessing
-        GLuint postprocessFrameBuffer, postProcessVertexArray;
-        Texture2D *colorTarget, *depthTarget;
-        TexturedMaterial* postprocessMaterial;
+        // A command for every mesh renderer in the world and their world space bounding spheres (in the same order)
+        // They are kept between frames so that the per-frame work is only culling and sorting
+        std::vector<RetainedCommand> retainedCommands;
+        SphereList retainedBounds;
+        // The world and the "MeshRendererComponent::instancesVersion" for which the retained list was built
+        World* retainedWorld = nullptr;
+        std::uint64_t retainedVersion = 0;
+        std::vector<std::uint8_t> commandVisibility;
+        // If true, the commands outside the camera frustum are not drawn
+        bool frustumCullingEnabled = true;
+        // If true, the bounding boxes of the commands are tested against the depth buffer after the opaque pass
+        // and the commands whose box was completely hidden (in a previous frame) are not drawn
+        bool occlusionCullingEnabled = false;
+        OcclusionCuller occlusionCuller;
+        // The indices of the retained commands whose bounding box will be tested this frame
+        std::vector<size_t> occlusionTested;
+        CullingStatistics cullingStatistics;
+        // The temporary storage used by the radix sort of the commands
+        std::vector<RenderCommand> sortScratch;
+        // Objects used for rendering the sky (see "sky.vert")
+        ShaderProgram* skyShader = nullptr;
+        GLint skyInverseVPLocation = -1, skyCameraPositionLocation = -1;
+        TextureCube* skyTexture = nullptr;
+        Sampler* skySampler = nullptr;
+        PipelineState skyPipelineState;
+        GLuint skyVertexArray = 0;
+        // The cubemap faces being converted from the equirectangular sky image on a worker thread
+        std::future<texture_utils::CubemapFaces> skyFaces;
+        // Objects used for Postprocessing: the scene is drawn into the color and depth targets which the chain then reads
+        PostprocessChain postprocessChain;
+        // The part of the scene targets that the scene is drawn into (smaller than the window when the quality governor lowers the render scale)
+        glm::ivec2 renderSize;
+        // The quality governor picks the render scale, the postprocess quality and the light count from the time the frames take
+        QualityGovernor qualityGovernor;
+        // The GL_TIME_ELAPSED queries of the last frames (used as a ring) and the last measured times in milliseconds
+        GLuint frameTimeQueries[FRAME_TIME_QUERY_COUNT] = {};
+        bool frameTimeQueryIssued[FRAME_TIME_QUERY_COUNT] = {};
+        size_t frameTimeQueryIndex = 0;
+        float cpuFrameTime = 0.0f, gpuFrameTime = 0.0f;
+        GLuint postprocessFrameBuffer = 0, postProcessVertexArray = 0;
+        Texture2D *colorTarget = nullptr, *depthTarget = nullptr;
+        // If true, the transparent commands whose shader supports it are drawn with weighted blended order independent transparency:
+        // they are added (in any order) into an accumulation and a weight target which are then composited over the scene
+        // It shares the depth target of the postprocess framebuffer, so it needs a postprocess chain
+        bool weightedBlendedEnabled = false;
+        GLuint weightedBlendedFrameBuffer = 0;
+        Texture2D *accumulationTarget = nullptr, *weightTarget = nullptr;
+        ShaderProgram *compositeShader = nullptr;
+        PipelineState compositePipelineState;
+        // Whether the weighted blended variant of every transparent shader drawn so far writes the weighted blended targets
+        std::unordered_map<ShaderProgram*, bool> weightedBlendedSupport;
+        // Whether the instanced variant of every shader drawn so far reads the instance model matrix
+        std::unordered_map<ShaderProgram*, bool> instancingSupport;
         //vector hold the light component from the entities that has light components 
         std::vector<LightComponent*> lights;
         Entity* player;
+        // The uniform buffer holding the "Frame" block, written once per frame
+        UniformBuffer *frameUniforms = nullptr;
+        // The lights assigned to the clusters of the view frustum
+        LightClusters lightClusters;
+        // If true, the opaque commands are drawn twice: first into the depth buffer only and then shaded with GL_EQUAL depth testing
+        // so that the expensive fragment shaders run once per pixel no matter how much overdraw there is
+        bool depthPrepassEnabled = false;
+        // If true, consecutive commands with the same mesh and material are drawn with a single instanced draw call
+        bool instancingEnabled = true;
+        // The model matrices of every command in this frame (opaque then transparent) and the buffer they are streamed to
+        std::vector<InstanceData> instanceData;
+        GLuint instanceBuffer = 0;
+        // The pre-resolved uniform locations of every shader drawn so far
+        std::unordered_map<ShaderProgram*, RendererUniforms> rendererUniforms;
+        // The defines of the (instanced) variants of the lit shaders for the lights of the current frame
+        // indexed by whether the mesh has baked light ("RenderCommand::bakedLighting")
+        std::string lightDefines[2], instancedLightDefines[2];
+
+        // Packs the pass, state and quantized depth (distance along the camera forward divided by the far plane distance) of a command
+        static std::uint64_t makeSortKey(RenderPass pass, const RenderCommand& command, float depth);
+
+        // Brings the retained commands up to date with the mesh renderers of the world
+        // Mesh renderers that were added or removed are detected through "MeshRendererComponent::instancesVersion",
+        // and a command is only rebuilt when the transform of its entity (or an ancestor), its mesh or its material changed
+        void updateRetainedCommands(World* world);
+
+        // Returns the renderer uniform locations of the given shader (resolving them on first use)
+        const RendererUniforms& getUniforms(ShaderProgram* shader);
+
+        // Sets up the material with the given program for the given draw mode
+        // If "depthOnlyProgram" is true, the program is a depth only variant so the material uniforms and textures are skipped
+        static void setupMaterial(const Material* material, ShaderProgram* program, DrawMode mode, bool depthOnlyProgram);
+
+        // Draws "count" (sorted) commands. Runs of commands sharing the same mesh and material are drawn as one instanced draw
+        // "instanceBase" is the index in "instanceData" of the data of the first command
+        void drawCommands(const RenderCommand* commands, size_t count, size_t instanceBase, const glm::mat4& VP, DrawMode mode = DrawMode::COLOR);
+
+        // Returns the framebuffer that the scene is drawn to (the postprocess framebuffer if there is one)
+        GLuint getTargetFramebuffer() const { return postprocessChain.isEnabled() ? postprocessFrameBuffer : 0; }
+
+        // Draws the opaque commands starting from "first" (with the depth pre-pass if it is enabled)
+        void drawForwardOpaqueCommands(size_t first, const glm::mat4& VP);
+
+        // Returns true if the given shader has an instanced variant (checking it on first use)
+        bool supportsInstancing(ShaderProgram* shader);
+        // Returns true if the given shader has a weighted blended variant (checking it on first use)
+        bool supportsWeightedBlended(ShaderProgram* shader);
+        // Draws the transparent commands: the weighted blended ones first (followed by their composite) and then the sorted ones
+        void drawTransparentCommands(const glm::mat4& VP);
+
+        // Keeps the directional lights and the "maxLights" other lights that are nearest to the camera
+        void limitLights(const glm::vec3& cameraPosition, size_t maxLights);
+
+        // Returns the pass in which the given opaque command is drawn
+        virtual RenderPass getOpaquePass(const RenderCommand& command) const { return RenderPass::OPAQUE_PASS; }
+        // Draws all the opaque commands into the target framebuffer (which is bound and cleared)
+        // The Frame block, the lights and the instance data of the frame are already uploaded
+        virtual void drawOpaqueCommands(const glm::mat4& VP) { drawForwardOpaqueCommands(0, VP); }
     public:
+        virtual ~ForwardRenderer() = default;
+
         // Initialize the renderer including the sky and the Postprocessing objects.
         // windowSize is the width & height of the window (in pixels).
-        void initialize(glm::ivec2 windowSize, const nlohmann::json &config, Entity *player = nullptr);
+        virtual void initialize(glm::ivec2 windowSize, const nlohmann::json &config, Entity *player = nullptr);
         // Clean up the renderer
-        void destroy();
+        virtual void destroy();
         // This function should be called every frame to draw the given world
         void render(World* world,bool increaseSpeedEffect = false, bool collisionEffect = false);
 
+        // Returns the lights of the last frame and their assignment to the clusters
+        const LightClusters& getLightClusters() const { return lightClusters; }
+
+        // Returns how many commands were submitted and culled in the last frame
+        const CullingStatistics& getCullingStatistics() const { return cullingStatistics; }
+
+        // Returns the quality governor (to show its overlay)
+        const QualityGovernor& getQualityGovernor() const { return qualityGovernor; }
+
 
     };
 
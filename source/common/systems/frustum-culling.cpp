@@ -0,0 +1,82 @@
+#include "frustum-culling.hpp"
+
+// SSE is always available on x86-64 so we only need to check for the architecture (or for SSE on 32-bit builds)
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_CULLING_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace our {
+
+    Frustum Frustum::fromViewProjection(const glm::mat4& VP) {
+        // glm matrices are column major, so row i is (VP[0][i], VP[1][i], VP[2][i], VP[3][i])
+        glm::vec4 row0(VP[0][0], VP[1][0], VP[2][0], VP[3][0]);
+        glm::vec4 row1(VP[0][1], VP[1][1], VP[2][1], VP[3][1]);
+        glm::vec4 row2(VP[0][2], VP[1][2], VP[2][2], VP[3][2]);
+        glm::vec4 row3(VP[0][3], VP[1][3], VP[2][3], VP[3][3]);
+
+        Frustum frustum;
+        frustum.planes[0] = row3 + row0; // Left
+        frustum.planes[1] = row3 - row0; // Right
+        frustum.planes[2] = row3 + row1; // Bottom
+        frustum.planes[3] = row3 - row1; // Top
+        frustum.planes[4] = row3 + row2; // Near
+        frustum.planes[5] = row3 - row2; // Far
+        // Normalize the planes so that the plane equation gives the actual distance (needed to compare it with the radius)
+        for(auto& plane : frustum.planes)
+            plane /= glm::length(glm::vec3(plane));
+        return frustum;
+    }
+
+    size_t SphereList::cull(const Frustum& frustum, std::vector<std::uint8_t>& visible) const {
+        const size_t count = size();
+        visible.resize(count);
+        size_t visibleCount = 0;
+        size_t index = 0;
+
+#if defined(FRUSTUM_CULLING_SSE)
+        // Broadcast every plane component once, then test 4 spheres against all the planes per iteration
+        __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for(int plane = 0; plane < 6; plane++){
+            planeX[plane] = _mm_set1_ps(frustum.planes[plane].x);
+            planeY[plane] = _mm_set1_ps(frustum.planes[plane].y);
+            planeZ[plane] = _mm_set1_ps(frustum.planes[plane].z);
+            planeW[plane] = _mm_set1_ps(frustum.planes[plane].w);
+        }
+        for(; index + 4 <= count; index += 4){
+            __m128 sx = _mm_loadu_ps(&x[index]);
+            __m128 sy = _mm_loadu_ps(&y[index]);
+            __m128 sz = _mm_loadu_ps(&z[index]);
+            __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radius[index]));
+            __m128 outside = _mm_setzero_ps();
+            for(int plane = 0; plane < 6; plane++){
+                __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(planeX[plane], sx), _mm_mul_ps(planeY[plane], sy)),
+                    _mm_add_ps(_mm_mul_ps(planeZ[plane], sz), planeW[plane]));
+                // A sphere is outside if it is completely behind any of the planes
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+            }
+            int outsideMask = _mm_movemask_ps(outside);
+            for(int lane = 0; lane < 4; lane++){
+                std::uint8_t isVisible = (outsideMask >> lane) & 1 ? 0 : 1;
+                visible[index + lane] = isVisible;
+                visibleCount += isVisible;
+            }
+        }
+#endif
+        // The scalar path handles the remaining spheres (or all of them if SSE is not available)
+        for(; index < count; index++){
+            std::uint8_t isVisible = 1;
+            for(const auto& plane : frustum.planes){
+                if(plane.x * x[index] + plane.y * y[index] + plane.z * z[index] + plane.w < -radius[index]){
+                    isVisible = 0;
+                    break;
+                }
+            }
+            visible[index] = isVisible;
+            visibleCount += isVisible;
+        }
+        return visibleCount;
+    }
+
+}
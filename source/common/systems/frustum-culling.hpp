@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace our {
+
+    // The six planes of a view frustum in world space
+    // Every plane is stored as (normal, distance) where the normal points inside the frustum,
+    // so a point p is inside the plane if dot(normal, p) + distance >= 0
+    struct Frustum {
+        glm::vec4 planes[6];
+
+        // Extracts the planes from a view-projection matrix (Gribb & Hartmann)
+        static Frustum fromViewProjection(const glm::mat4& VP);
+    };
+
+    // A set of world space bounding spheres stored as a structure of arrays so that they can be tested 4 at a time
+    class SphereList {
+        std::vector<float> x, y, z, radius;
+    public:
+        void clear() { x.clear(); y.clear(); z.clear(); radius.clear(); }
+
+        void add(const glm::vec3& center, float sphereRadius) {
+            x.push_back(center.x);
+            y.push_back(center.y);
+            z.push_back(center.z);
+            radius.push_back(sphereRadius);
+        }
+
+        size_t size() const { return x.size(); }
+
+        void resize(size_t count) { x.resize(count); y.resize(count); z.resize(count); radius.resize(count); }
+
+        void set(size_t index, const glm::vec3& center, float sphereRadius) {
+            x[index] = center.x;
+            y[index] = center.y;
+            z[index] = center.z;
+            radius[index] = sphereRadius;
+        }
+
+        // Tests every sphere against the frustum and writes 1 in "visible" for those which intersect it and 0 for the others
+        // "visible" is resized to the number of spheres. Returns the number of visible spheres
+        size_t cull(const Frustum& frustum, std::vector<std::uint8_t>& visible) const;
+    };
+
+}
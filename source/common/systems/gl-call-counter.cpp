@@ -0,0 +1,142 @@
+#include "gl-call-counter.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(ENABLE_GL_CALL_COUNTER)
+
+namespace our
+{
+
+    namespace
+    {
+        bool enabled = false;
+        GLCallStatistics currentFrame, lastFrame;
+        // If an output file is given, the counts of every frame are kept and written to it when the counter is destroyed
+        std::string outputPath;
+        std::vector<GLCallStatistics> history;
+
+        // Wraps the glad function pointer "Entry" (e.g. &glad_glDrawArrays) with a function that increments "Counter"
+        // then calls the original function. Since the entry is a template argument, every function gets its own wrapper
+        template<auto *Entry, size_t GLCallStatistics::*Counter, typename Proc = std::remove_pointer_t<decltype(Entry)>>
+        struct Interposer;
+
+        template<auto *Entry, size_t GLCallStatistics::*Counter, typename... Args>
+        struct Interposer<Entry, Counter, void (GLAD_API_PTR *)(Args...)> {
+            static inline void (GLAD_API_PTR *original)(Args...) = nullptr;
+
+            static void GLAD_API_PTR call(Args... args) {
+                currentFrame.*Counter += 1;
+                original(args...);
+            }
+
+            static void install() {
+                // Functions that the driver does not support stay null
+                if (*Entry == nullptr || *Entry == call)
+                    return;
+                original = *Entry;
+                *Entry = call;
+            }
+
+            static void uninstall() {
+                if (*Entry == call)
+                    *Entry = original;
+            }
+        };
+
+        // The counted functions and the counter of each one
+        #define GL_COUNTED_CALLS(X)                                  \
+            X(glDrawArrays, drawCalls)                               \
+            X(glDrawArraysInstanced, drawCalls)                      \
+            X(glDrawElements, drawCalls)                             \
+            X(glDrawElementsInstanced, drawCalls)                    \
+            X(glDrawElementsBaseVertex, drawCalls)                   \
+            X(glDrawElementsInstancedBaseVertex, drawCalls)          \
+            X(glUseProgram, programBinds)                            \
+            X(glUniform1i, uniformUploads)                           \
+            X(glUniform1ui, uniformUploads)                          \
+            X(glUniform1f, uniformUploads)                           \
+            X(glUniform2f, uniformUploads)                           \
+            X(glUniform3f, uniformUploads)                           \
+            X(glUniform4f, uniformUploads)                           \
+            X(glUniform1fv, uniformUploads)                          \
+            X(glUniform2fv, uniformUploads)                          \
+            X(glUniform3fv, uniformUploads)                          \
+            X(glUniform4fv, uniformUploads)                          \
+            X(glUniformMatrix3fv, uniformUploads)                    \
+            X(glUniformMatrix4fv, uniformUploads)                    \
+            X(glBindTexture, textureBinds)                           \
+            X(glBindSampler, samplerBinds)                           \
+            X(glBufferData, bufferUploads)                           \
+            X(glBufferSubData, bufferUploads)                        \
+            X(glEnable, stateToggles)                                \
+            X(glDisable, stateToggles)                               \
+            X(glBlendFunc, stateToggles)                             \
+            X(glBlendFuncSeparate, stateToggles)                     \
+            X(glBlendEquation, stateToggles)                         \
+            X(glBlendColor, stateToggles)                            \
+            X(glDepthFunc, stateToggles)                             \
+            X(glDepthMask, stateToggles)                             \
+            X(glColorMask, stateToggles)                             \
+            X(glCullFace, stateToggles)                              \
+            X(glFrontFace, stateToggles)
+
+        #define GL_INSTALL_COUNTED_CALL(name, counter) Interposer<&glad_##name, &GLCallStatistics::counter>::install();
+        #define GL_UNINSTALL_COUNTED_CALL(name, counter) Interposer<&glad_##name, &GLCallStatistics::counter>::uninstall();
+    }
+
+    void GLCallCounter::initialize(const nlohmann::json &config)
+    {
+        enabled = config.is_object() && config.value("enabled", false);
+        outputPath = config.is_object() ? config.value("output", "") : "";
+        currentFrame = lastFrame = GLCallStatistics();
+        history.clear();
+        if (!enabled)
+            return;
+        GL_COUNTED_CALLS(GL_INSTALL_COUNTED_CALL)
+    }
+
+    void GLCallCounter::destroy()
+    {
+        if (!enabled)
+            return;
+        GL_COUNTED_CALLS(GL_UNINSTALL_COUNTED_CALL)
+        enabled = false;
+
+        if (outputPath.empty())
+            return;
+        nlohmann::json frames = nlohmann::json::array();
+        for (const auto &frame : history)
+            frames.push_back(frame.serialize());
+        std::ofstream file(outputPath);
+        if (file)
+        {
+            file << frames.dump(2) << std::endl;
+            std::cout << "GL call counts saved to: " << outputPath << std::endl;
+        }
+        else
+            std::cerr << "Failed to save the GL call counts to: " << outputPath << std::endl;
+    }
+
+    bool GLCallCounter::isEnabled() { return enabled; }
+
+    void GLCallCounter::endFrame()
+    {
+        lastFrame = currentFrame;
+        currentFrame = GLCallStatistics();
+        if (enabled && !outputPath.empty())
+            history.push_back(lastFrame);
+    }
+
+    const std::vector<GLCallStatistics> &GLCallCounter::getHistory() { return history; }
+
+    const GLCallStatistics &GLCallCounter::getLastFrame() { return lastFrame; }
+
+    const GLCallStatistics &GLCallCounter::getCurrentFrame() { return currentFrame; }
+
+}
+
+#endif
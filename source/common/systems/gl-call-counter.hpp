@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <json/json.hpp>
+#include <vector>
+
+#if !defined(NDEBUG)
+// If NDEBUG (no debug) is not defined, count the OpenGL calls (in release builds the counter compiles to nothing)
+#define ENABLE_GL_CALL_COUNTER
+#endif
+
+namespace our
+{
+
+    // The number of OpenGL calls of each kind issued in a frame
+    struct GLCallStatistics {
+        // glDrawArrays, glDrawElements and their instanced and base vertex variants
+        size_t drawCalls = 0;
+        // glUseProgram
+        size_t programBinds = 0;
+        // glUniform*
+        size_t uniformUploads = 0;
+        // glBindTexture
+        size_t textureBinds = 0;
+        // glBindSampler
+        size_t samplerBinds = 0;
+        // glBufferData and glBufferSubData
+        size_t bufferUploads = 0;
+        // glEnable, glDisable and the blending, depth, color mask and face culling state
+        size_t stateToggles = 0;
+
+        size_t getTotal() const {
+            return drawCalls + programBinds + uniformUploads + textureBinds + samplerBinds + bufferUploads + stateToggles;
+        }
+
+        // Returns the counts as a json object (the keys are the names of the members)
+        nlohmann::json serialize() const {
+            return {
+                {"drawCalls", drawCalls},
+                {"programBinds", programBinds},
+                {"uniformUploads", uniformUploads},
+                {"textureBinds", textureBinds},
+                {"samplerBinds", samplerBinds},
+                {"bufferUploads", bufferUploads},
+                {"stateToggles", stateToggles}
+            };
+        }
+    };
+
+    // The GL call counter replaces the glad function pointers of the OpenGL functions used by the engine with wrappers
+    // that count the call before forwarding it to the driver, so it sees everything the renderer, the materials, the shaders
+    // and the meshes actually send (including the calls that the pipeline state cache lets through).
+    // It only exists in debug builds, in release builds every function is an empty inline function and the statistics stay zero
+    // Like the pipeline state cache, the counter is shared by the whole application
+    class GLCallCounter {
+    public:
+#if defined(ENABLE_GL_CALL_COUNTER)
+        // Reads the "glCallCounter" object of the application config ({"enabled": true, "output": "counts.json"}) and installs the wrappers if it is enabled (a missing object means disabled)
+        // It must be called after the OpenGL functions are loaded by glad
+        static void initialize(const nlohmann::json& config);
+        // Restores the original function pointers and writes the counts of every frame to the output file (if any)
+        static void destroy();
+
+        static bool isEnabled();
+
+        // Ends the frame: the counts of the frame become the last frame statistics and the counters start over
+        static void endFrame();
+
+        // Returns the counts of the last complete frame
+        static const GLCallStatistics& getLastFrame();
+        // Returns the counts of the frame so far
+        static const GLCallStatistics& getCurrentFrame();
+        // Returns the counts of every complete frame (only kept if there is an output file)
+        static const std::vector<GLCallStatistics>& getHistory();
+#else
+        static void initialize(const nlohmann::json&) {}
+        static void destroy() {}
+        static bool isEnabled() { return false; }
+        static void endFrame() {}
+        static const GLCallStatistics& getLastFrame() { static const GLCallStatistics empty; return empty; }
+        static const GLCallStatistics& getCurrentFrame() { return getLastFrame(); }
+        static const std::vector<GLCallStatistics>& getHistory() { static const std::vector<GLCallStatistics> empty; return empty; }
+#endif
+    };
+
+}
@@ -0,0 +1,215 @@
+#include "gpu-profiler.hpp"
+
+#include <imgui.h>
+#include <algorithm>
+
+namespace our
+{
+
+    namespace
+    {
+        // A scope issued in a frame: its two timestamp queries are "2 * index" and "2 * index + 1" of the frame
+        struct ScopeRecord {
+            const char *name;
+            int depth;
+        };
+
+        struct FrameQueries {
+            GLuint queries[2 * GPU_PROFILER_MAX_SCOPES] = {};
+            ScopeRecord scopes[GPU_PROFILER_MAX_SCOPES];
+            size_t scopeCount = 0;
+            // The query that was written last in the frame (the end of the "Frame" scope since it closes last)
+            GLuint lastQuery = 0;
+            bool issued = false;
+        };
+
+        bool enabled = false, panelEnabled = false, debugGroups = false;
+        FrameQueries frames[GPU_PROFILER_FRAME_LATENCY];
+        size_t frameIndex = 0;
+        // The records of the open scopes (-1 for the scopes that did not fit in the frame and are only debug groups)
+        // The scopes nested deeper than GPU_PROFILER_MAX_SCOPES are only counted in openScopeCount (they have no entry
+        // and no debug group) so that their endScope closes them instead of an enclosing scope
+        int openScopes[GPU_PROFILER_MAX_SCOPES];
+        int openScopeCount = 0;
+        std::vector<GpuScopeStatistics> statistics;
+        size_t droppedFrames = 0;
+
+        GpuScopeStatistics &getScopeStatistics(const char *name, int depth)
+        {
+            for (auto &scope : statistics)
+                if (scope.name == name)
+                    return scope;
+            GpuScopeStatistics &scope = statistics.emplace_back();
+            scope.name = name;
+            scope.depth = depth;
+            return scope;
+        }
+
+        // Reads the timestamps of the given frame if they are all done
+        // They complete in the order they were written, so only the one written last is checked
+        void readBack(FrameQueries &frame)
+        {
+            if (!frame.issued || frame.scopeCount == 0 || frame.lastQuery == 0)
+                return;
+            frame.issued = false;
+            GLint available = 0;
+            glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                droppedFrames++;
+                return;
+            }
+            for (size_t index = 0; index < frame.scopeCount; index++)
+            {
+                GLuint64 begin = 0, end = 0;
+                glGetQueryObjectui64v(frame.queries[2 * index], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(frame.queries[2 * index + 1], GL_QUERY_RESULT, &end);
+                getScopeStatistics(frame.scopes[index].name, frame.scopes[index].depth).addSample((end - begin) * 1e-6f);
+            }
+        }
+    }
+
+    void GpuScopeStatistics::addSample(float time)
+    {
+        last = time;
+        samples[nextSample] = time;
+        nextSample = (nextSample + 1) % GPU_PROFILER_HISTORY;
+        sampleCount = std::min(sampleCount + 1, (size_t)GPU_PROFILER_HISTORY);
+
+        float sum = 0.0f;
+        minimum = maximum = samples[0];
+        for (size_t index = 0; index < sampleCount; index++)
+        {
+            sum += samples[index];
+            minimum = std::min(minimum, samples[index]);
+            maximum = std::max(maximum, samples[index]);
+        }
+        average = sum / sampleCount;
+    }
+
+    void GpuProfiler::initialize(const nlohmann::json &config)
+    {
+        enabled = config.is_object() && config.value("enabled", true);
+        panelEnabled = enabled && config.value("panel", false);
+        // The debug groups need KHR_debug (core since OpenGL 4.3)
+        debugGroups = enabled && glPushDebugGroup && glPopDebugGroup;
+        if (!enabled)
+            return;
+        for (auto &frame : frames)
+        {
+            glGenQueries(2 * GPU_PROFILER_MAX_SCOPES, frame.queries);
+            frame.scopeCount = 0;
+            frame.lastQuery = 0;
+            frame.issued = false;
+        }
+        frameIndex = 0;
+        openScopeCount = 0;
+        statistics.clear();
+        droppedFrames = 0;
+    }
+
+    void GpuProfiler::destroy()
+    {
+        if (!enabled)
+            return;
+        for (auto &frame : frames)
+            glDeleteQueries(2 * GPU_PROFILER_MAX_SCOPES, frame.queries);
+        enabled = panelEnabled = debugGroups = false;
+    }
+
+    bool GpuProfiler::isEnabled() { return enabled; }
+
+    bool GpuProfiler::isPanelEnabled() { return panelEnabled; }
+
+    void GpuProfiler::beginFrame()
+    {
+        if (!enabled)
+            return;
+        // The queries of this slot were issued GPU_PROFILER_FRAME_LATENCY frames ago, so they are read before being reused
+        FrameQueries &frame = frames[frameIndex];
+        readBack(frame);
+        frame.scopeCount = 0;
+        frame.lastQuery = 0;
+        openScopeCount = 0;
+        beginScope("Frame");
+    }
+
+    void GpuProfiler::endFrame()
+    {
+        if (!enabled)
+            return;
+        // Any scope left open is closed with the frame
+        while (openScopeCount > 0)
+            endScope();
+        frames[frameIndex].issued = true;
+        frameIndex = (frameIndex + 1) % GPU_PROFILER_FRAME_LATENCY;
+    }
+
+    void GpuProfiler::beginScope(const char *name)
+    {
+        if (!enabled)
+            return;
+        if (openScopeCount >= GPU_PROFILER_MAX_SCOPES)
+        {
+            openScopeCount++;
+            return;
+        }
+        if (debugGroups)
+            glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+        FrameQueries &frame = frames[frameIndex];
+        if (frame.scopeCount >= GPU_PROFILER_MAX_SCOPES)
+        {
+            openScopes[openScopeCount++] = -1;
+            return;
+        }
+        size_t index = frame.scopeCount++;
+        frame.scopes[index] = {name, openScopeCount};
+        glQueryCounter(frame.queries[2 * index], GL_TIMESTAMP);
+        openScopes[openScopeCount++] = (int)index;
+    }
+
+    void GpuProfiler::endScope()
+    {
+        if (!enabled || openScopeCount == 0)
+            return;
+        if (--openScopeCount >= GPU_PROFILER_MAX_SCOPES)
+            return;
+        int index = openScopes[openScopeCount];
+        if (index >= 0)
+        {
+            FrameQueries &frame = frames[frameIndex];
+            glQueryCounter(frame.queries[2 * index + 1], GL_TIMESTAMP);
+            frame.lastQuery = frame.queries[2 * index + 1];
+        }
+        if (debugGroups)
+            glPopDebugGroup();
+    }
+
+    const std::vector<GpuScopeStatistics> &GpuProfiler::getStatistics() { return statistics; }
+
+    const GpuScopeStatistics *GpuProfiler::findStatistics(const std::string &name)
+    {
+        for (auto &scope : statistics)
+            if (scope.name == name)
+                return &scope;
+        return nullptr;
+    }
+
+    size_t GpuProfiler::getDroppedFrames() { return droppedFrames; }
+
+    void GpuProfiler::drawPanel()
+    {
+        ImGui::SetNextWindowPos(ImVec2(10, 300), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowBgAlpha(0.5f);
+        ImGui::Begin("GPU Profiler", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing);
+        ImGui::Text("%-24s %8s %8s %8s %8s", "Scope (ms)", "Last", "Average", "Min", "Max");
+        ImGui::Separator();
+        for (const auto &scope : statistics)
+            ImGui::Text("%*s%-*s %8.3f %8.3f %8.3f %8.3f", 2 * scope.depth, "", 24 - 2 * scope.depth, scope.name.c_str(),
+                        scope.last, scope.average, scope.minimum, scope.maximum);
+        ImGui::Separator();
+        ImGui::Text("Dropped frames: %d", (int)droppedFrames);
+        ImGui::End();
+    }
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <json/json.hpp>
+#include <string>
+#include <vector>
+
+namespace our
+{
+
+    // The number of frames whose queries are in flight, a frame is read back this many frames after it was issued
+    #define GPU_PROFILER_FRAME_LATENCY 4
+    // The most scopes that are timed in a frame (the scopes after them are only pushed as debug groups)
+    #define GPU_PROFILER_MAX_SCOPES 64
+    // The number of frames over which the average, minimum and maximum of every scope are computed
+    #define GPU_PROFILER_HISTORY 120
+
+    // The GPU times (in milliseconds) of a named scope over the last GPU_PROFILER_HISTORY frames in which it ran
+    struct GpuScopeStatistics {
+        std::string name;
+        // How many scopes the scope is nested in
+        int depth = 0;
+        float last = 0.0f, average = 0.0f, minimum = 0.0f, maximum = 0.0f;
+        float samples[GPU_PROFILER_HISTORY] = {};
+        size_t sampleCount = 0, nextSample = 0;
+
+        void addSample(float time);
+    };
+
+    // The GPU profiler measures how long named scopes of the frame take on the GPU using a GL_TIMESTAMP query
+    // at the start and at the end of every scope (unlike GL_TIME_ELAPSED queries, timestamps can be nested).
+    // The queries of a frame are only read back GPU_PROFILER_FRAME_LATENCY frames later, and if they are still not done
+    // the frame is dropped instead of waiting, so the profiler never stalls the pipeline.
+    // Every scope is also pushed as a KHR_debug group so that it shows up in frame debuggers (e.g. RenderDoc)
+    // Like the pipeline state cache, the profiler is shared by the whole application
+    class GpuProfiler {
+    public:
+        // Reads the "gpuProfiler" object of the application config ({"enabled": true, "panel": true}) and creates the queries
+        static void initialize(const nlohmann::json& config);
+        static void destroy();
+
+        static bool isEnabled();
+        // Returns true if the ImGui panel should be shown (see "drawPanel")
+        static bool isPanelEnabled();
+
+        // Marks the start and the end of a frame (the whole frame is timed as the "Frame" scope)
+        static void beginFrame();
+        static void endFrame();
+
+        // Opens and closes a scope. The name must outlive the frame (a string literal)
+        static void beginScope(const char* name);
+        static void endScope();
+
+        // Returns the statistics of every scope seen so far (a scope always comes after the scope it was first nested in)
+        static const std::vector<GpuScopeStatistics>& getStatistics();
+        // Returns the statistics of the scope with the given name (or nullptr if it never ran)
+        static const GpuScopeStatistics* findStatistics(const std::string& name);
+        // Returns how many frames were dropped since their queries were not done when they were read back
+        static size_t getDroppedFrames();
+
+        // Shows the statistics of every scope in an ImGui window
+        static void drawPanel();
+    };
+
+    // Times the scope in which it lives
+    class GpuProfileScope {
+    public:
+        explicit GpuProfileScope(const char* name) { GpuProfiler::beginScope(name); }
+        ~GpuProfileScope() { GpuProfiler::endScope(); }
+
+        GpuProfileScope(const GpuProfileScope&) = delete;
+        GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+    };
+
+}
@@ -0,0 +1,130 @@
+#include "light-baker.hpp"
+#include "../asset-loader.hpp"
+#include "../ecs/entity.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <string>
+
+namespace our
+{
+
+    // The number of vertices that a worker thread lights before picking up the next chunk
+    #define LIGHT_BAKING_CHUNK_SIZE 1024
+
+    // The diffuse light that a directional light gives a surface (the same as the diffuse term of "light.frag" without the albedo)
+    static glm::vec3 computeDiffuseLight(const LightComponent *light, const glm::vec3 &normal)
+    {
+        return light->color * glm::max(0.0f, glm::dot(normal, -light->direction));
+    }
+
+    // Encodes the light in RGBM (see "BAKED_LIGHT_RANGE")
+    static Color encodeLight(glm::vec3 light)
+    {
+        light = glm::max(light / BAKED_LIGHT_RANGE, glm::vec3(0.0f));
+        float multiplier = glm::clamp(std::max(light.r, std::max(light.g, light.b)), 1.0f / 255.0f, 1.0f);
+        // The multiplier is rounded up so that the color channels never need to go above 1
+        multiplier = std::ceil(multiplier * 255.0f) / 255.0f;
+        glm::vec3 color = glm::clamp(light / multiplier, 0.0f, 1.0f);
+        return Color(glm::round(glm::vec4(color, multiplier) * 255.0f));
+    }
+
+    void LightBaker::computeLight(const std::vector<LightComponent *> &lights, const std::vector<glm::vec3> &normals,
+                                  std::vector<glm::vec3> &light) const
+    {
+        const size_t vertexCount = normals.size();
+        const size_t chunkCount = (vertexCount + LIGHT_BAKING_CHUNK_SIZE - 1) / LIGHT_BAKING_CHUNK_SIZE;
+        std::atomic<size_t> nextChunk{0};
+        auto worker = [&]()
+        {
+            for (size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+            {
+                size_t end = std::min(vertexCount, (chunk + 1) * LIGHT_BAKING_CHUNK_SIZE);
+                for (size_t index = chunk * LIGHT_BAKING_CHUNK_SIZE; index < end; index++)
+                    for (auto bakedLight : lights)
+                        light[index] += computeDiffuseLight(bakedLight, normals[index]);
+            }
+        };
+
+        unsigned int workers = threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+        workers = (unsigned int)std::min<size_t>(workers, chunkCount);
+        // The calling thread is one of the workers
+        std::vector<std::thread> threads;
+        for (unsigned int index = 1; index < workers; index++)
+            threads.emplace_back(worker);
+        worker();
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    size_t LightBaker::bake(World *world)
+    {
+        if (!enabled)
+            return 0;
+
+        std::vector<LightComponent *> lights;
+        std::vector<MeshRendererComponent *> meshRenderers;
+        for (auto entity : world->getEntities())
+        {
+            if (auto light = entity->getComponent<LightComponent>(); light && light->bake)
+            {
+                // The renderer moves the point and spot lights with the player every frame, so a baked copy would be left behind
+                if (light->lightType == DIRECTIONAL)
+                    lights.push_back(light);
+                else
+                    std::cerr << "Only directional lights can be baked, the light of \"" << entity->name << "\" stays realtime" << std::endl;
+            }
+
+            auto meshRenderer = entity->getComponent<MeshRendererComponent>();
+            if (!meshRenderer || !meshRenderer->mesh || meshRenderer->bakedLighting || !dynamic_cast<LightingMaterial *>(meshRenderer->material))
+                continue;
+            // The light of a directional light only depends on the world normal, so the entity may move as long as its
+            // world rotation and scale never change: it and each of its ancestors must be static or only translated
+            bool fixedOrientation = true;
+            for (Entity *ancestor = entity; ancestor && fixedOrientation; ancestor = ancestor->parent)
+                fixedOrientation = ancestor->isStatic || ancestor->isTranslationOnly;
+            if (fixedOrientation)
+                meshRenderers.push_back(meshRenderer);
+        }
+        if (lights.empty() || meshRenderers.empty())
+            return 0;
+
+        // The normals of all the meshes are gathered (in world space) so that they are lit together by the worker threads
+        std::vector<std::vector<Vertex>> meshVertices;
+        std::vector<glm::vec3> normals;
+        for (auto meshRenderer : meshRenderers)
+        {
+            meshVertices.push_back(meshRenderer->mesh->readVertices());
+            glm::mat3 M_IT = glm::transpose(glm::inverse(glm::mat3(meshRenderer->getOwner()->getLocalToWorldMatrix())));
+            for (const Vertex &vertex : meshVertices.back())
+                normals.push_back(glm::normalize(M_IT * vertex.normal));
+        }
+        std::vector<glm::vec3> light(normals.size(), glm::vec3(0.0f));
+        computeLight(lights, normals, light);
+
+        // Every mesh gets a copy with the baked light in its vertex colors
+        size_t first = 0;
+        for (size_t index = 0; index < meshRenderers.size(); index++)
+        {
+            MeshRendererComponent *meshRenderer = meshRenderers[index];
+            std::vector<Vertex> &vertices = meshVertices[index];
+            for (size_t vertex = 0; vertex < vertices.size(); vertex++)
+                vertices[vertex].color = encodeLight(light[first + vertex]);
+            first += vertices.size();
+
+            Mesh *mesh = new Mesh(vertices, meshRenderer->mesh->readElements());
+            AssetLoader<Mesh>::add("__baked_" + std::to_string(bakedCount++), mesh);
+            meshRenderer->mesh = mesh;
+            meshRenderer->bakedLighting = true;
+        }
+
+        // The BAKED_LIGHTING variant skips the baked lights from now on (the other meshes still compute them every frame)
+        for (auto bakedLight : lights)
+            bakedLight->baked = true;
+        return meshRenderers.size();
+    }
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+#include "../components/mesh-renderer.hpp"
+#include "../components/light.hpp"
+
+#include <json/json.hpp>
+#include <vector>
+
+namespace our
+{
+
+    // The baked light is stored in the vertex color as RGBM: the light is rgb * a * BAKED_LIGHT_RANGE
+    // so that it can go above 1 with the 8 bits of every channel (this must match "light.frag")
+    #define BAKED_LIGHT_RANGE 8.0f
+
+    // The light baker computes the diffuse lighting of the directional lights marked with "bake": true once (when the world is loaded)
+    // and stores it in the vertex colors of the lit meshes that never rotate, which are then drawn with the BAKED_LIGHTING variant
+    // of "light.frag" that reads it back instead of evaluating the diffuse of these lights every frame.
+    // Only directional lights are baked since the renderer moves the point and spot lights with the player. Their light only
+    // depends on the world normal, so the baked entities are the ones whose ancestors (and themselves) are all static or
+    // translation only (e.g. an entity that follows the camera without rotating).
+    // The baked lights still light every other mesh (the player, the trains, ...) in realtime, and the specular highlights
+    // depend on the view so they are computed every frame for the baked meshes too. The other realtime lights apply on top.
+    // The vertices are split between a few worker threads since every vertex is lit independently
+    class LightBaker
+    {
+        // If false, "bake" does nothing and every light stays realtime
+        bool enabled = true;
+        // The number of worker threads (0 means one per hardware thread)
+        unsigned int threadCount = 0;
+        // The number of meshes baked so far (used to give every baked mesh a unique name)
+        size_t bakedCount = 0;
+
+        // Adds the diffuse lighting of the directional "lights" for the given world space normals to "light"
+        // The vertices are split into chunks which are picked up by the worker threads
+        void computeLight(const std::vector<LightComponent *> &lights, const std::vector<glm::vec3> &normals,
+                          std::vector<glm::vec3> &light) const;
+
+    public:
+        // Reads the baker options from the renderer configuration
+        void deserialize(const nlohmann::json &config)
+        {
+            if (!config.is_object())
+                return;
+            enabled = config.value("lightBaking", enabled);
+            threadCount = config.value("lightBakingThreads", threadCount);
+        }
+
+        // Bakes the directional lights marked with "bake" into the lit meshes of the world that never rotate
+        // This should be called once after the world is deserialized (and after the static batches are created)
+        // Every baked mesh is a copy owned by the "AssetLoader<Mesh>" since the original may be drawn by other entities
+        // Returns the number of meshes that were baked
+        size_t bake(World *world);
+    };
+
+}
@@ -0,0 +1,153 @@
+#include "light-clusters.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+namespace our {
+
+    void LightClusters::initialize() {
+        lightData = new TextureBuffer(GL_RGBA32F);
+        clusterGrid = new TextureBuffer(GL_RGBA32UI, CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z * 4 * sizeof(std::uint32_t));
+        clusterLights = new TextureBuffer(GL_R32UI);
+    }
+
+    void LightClusters::destroy() {
+        delete lightData;
+        delete clusterGrid;
+        delete clusterLights;
+        lightData = clusterGrid = clusterLights = nullptr;
+    }
+
+    float LightClusters::getRange(const LightComponent* light) {
+        if(light->lightType == DIRECTIONAL) return -1.0f;
+        // The shader attenuates the light by 1 / (a*d^2 + b*d + c), so we solve a*d^2 + b*d + c = intensity / LIGHT_CUTOFF
+        float intensity = std::max(light->color.r, std::max(light->color.g, light->color.b));
+        float a = light->attenuation.x, b = light->attenuation.y, c = light->attenuation.z - intensity / LIGHT_CUTOFF;
+        if(c >= 0) return 0.0f;
+        if(a > 0) return (-b + std::sqrt(b * b - 4 * a * c)) / (2 * a);
+        if(b > 0) return -c / b;
+        return -1.0f;
+    }
+
+    void LightClusters::addLight(const LightComponent* light) {
+        lightTexels.emplace_back(light->position, (float)light->lightType);
+        // The cone angles are sent as cosines so that the shader compares them directly with the dot product
+        lightTexels.emplace_back(light->direction, std::cos(light->cone_angles.x));
+        lightTexels.emplace_back(light->color, std::cos(light->cone_angles.y));
+        lightTexels.emplace_back(light->attenuation, 0.0f);
+    }
+
+    void LightClusters::update(const std::vector<LightComponent*>& lights, const glm::mat4& VP, const glm::vec3& cameraPosition,
+        const glm::vec3& cameraForward, float near, float far) {
+        lightTexels.clear();
+        ranges.clear();
+        zScale = CLUSTER_COUNT_Z / std::log(far / near);
+        zBias = -std::log(near) * zScale;
+        auto slice = [&](float depth) {
+            return std::clamp((int)std::floor(std::log(depth) * zScale + zBias), 0, CLUSTER_COUNT_Z - 1);
+        };
+
+        // The global lights are added first (starting with the directional ones) so that the shader can loop over them
+        // before the lights of the cluster. The baked directional lights come before the others so that the meshes
+        // which already have them in their vertex colors can start their loop after them
+        for(auto light : lights)
+            if(light->lightType == DIRECTIONAL && light->baked) addLight(light);
+        bakedLightCount = (std::uint32_t)(lightTexels.size() / LIGHT_DATA_TEXELS);
+        for(auto light : lights)
+            if(light->lightType == DIRECTIONAL && !light->baked) addLight(light);
+        directionalLightCount = (std::uint32_t)(lightTexels.size() / LIGHT_DATA_TEXELS);
+        for(auto light : lights)
+            if(light->lightType != DIRECTIONAL && getRange(light) < 0) addLight(light);
+        globalLightCount = (std::uint32_t)(lightTexels.size() / LIGHT_DATA_TEXELS);
+
+        pointLightCount = spotLightCount = 0;
+        for(auto light : lights){
+            float range = getRange(light);
+            if(range <= 0) continue;
+            // Drop the lights whose sphere is completely in front of the near plane or behind the far plane
+            float depth = glm::dot(light->position - cameraPosition, cameraForward);
+            if(depth + range < near || depth - range > far) continue;
+
+            ClusterRange clusterRange;
+            clusterRange.z0 = slice(std::max(depth - range, near));
+            clusterRange.z1 = slice(std::min(depth + range, far));
+            // The tiles are found by projecting the corners of the box around the sphere
+            // If any of them is behind the camera, the projection is meaningless so the light covers the whole screen
+            clusterRange.x0 = 0; clusterRange.x1 = CLUSTER_COUNT_X - 1;
+            clusterRange.y0 = 0; clusterRange.y1 = CLUSTER_COUNT_Y - 1;
+            glm::vec2 minimum(FLT_MAX), maximum(-FLT_MAX);
+            bool behind = false;
+            for(int corner = 0; corner < 8 && !behind; corner++){
+                glm::vec3 offset((corner & 1) ? range : -range, (corner & 2) ? range : -range, (corner & 4) ? range : -range);
+                glm::vec4 clip = VP * glm::vec4(light->position + offset, 1.0f);
+                if(clip.w <= near * 0.5f){
+                    behind = true;
+                } else {
+                    glm::vec2 ndc = glm::vec2(clip) / clip.w;
+                    minimum = glm::min(minimum, ndc);
+                    maximum = glm::max(maximum, ndc);
+                }
+            }
+            if(!behind){
+                // The light is outside the view if its box is outside the screen
+                if(maximum.x < -1 || maximum.y < -1 || minimum.x > 1 || minimum.y > 1) continue;
+                auto tile = [](float ndc, int count) {
+                    return std::clamp((int)std::floor((ndc * 0.5f + 0.5f) * count), 0, count - 1);
+                };
+                clusterRange.x0 = tile(minimum.x, CLUSTER_COUNT_X); clusterRange.x1 = tile(maximum.x, CLUSTER_COUNT_X);
+                clusterRange.y0 = tile(minimum.y, CLUSTER_COUNT_Y); clusterRange.y1 = tile(maximum.y, CLUSTER_COUNT_Y);
+            }
+            clusterRange.light = (std::uint32_t)(lightTexels.size() / LIGHT_DATA_TEXELS);
+            clusterRange.type = light->lightType;
+            addLight(light);
+            ranges.push_back(clusterRange);
+            (light->lightType == SPOT ? spotLightCount : pointLightCount)++;
+        }
+        lightCount = (std::uint32_t)(lightTexels.size() / LIGHT_DATA_TEXELS);
+        // The ranges of the point lights are moved before the ones of the spot lights so that they come first in every cluster
+        std::partition(ranges.begin(), ranges.end(), [](const ClusterRange& range) { return range.type != SPOT; });
+
+        shaderDefines = "#define DIRECTIONAL_LIGHT_COUNT " + std::to_string(directionalLightCount) + "\n";
+        shaderDefines += "#define BAKED_LIGHT_COUNT " + std::to_string(bakedLightCount) + "\n";
+        if(pointLightCount > 0) shaderDefines += "#define POINT_LIGHTS\n";
+        if(spotLightCount > 0) shaderDefines += "#define SPOT_LIGHTS\n";
+
+        // First count the lights of every cluster (in the count slots of the grid), then turn the counts into offsets
+        // and finally write the light indices while moving the offsets forward (like a counting sort)
+        // Every cluster takes 4 values: offset, point light count, spot light count and an unused one
+        const size_t clusterCount = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+        grid.assign(clusterCount * 4, 0);
+        auto forEachCluster = [](const ClusterRange& range, auto function) {
+            for(int z = range.z0; z <= range.z1; z++)
+                for(int y = range.y0; y <= range.y1; y++)
+                    for(int x = range.x0; x <= range.x1; x++)
+                        function((z * CLUSTER_COUNT_Y + y) * CLUSTER_COUNT_X + x);
+        };
+        for(const auto& range : ranges){
+            int slot = range.type == SPOT ? 2 : 1;
+            forEachCluster(range, [&](size_t cluster) { grid[cluster * 4 + slot]++; });
+        }
+        std::uint32_t offset = 0;
+        for(size_t cluster = 0; cluster < clusterCount; cluster++){
+            grid[cluster * 4] = offset;
+            offset += grid[cluster * 4 + 1] + grid[cluster * 4 + 2];
+        }
+        indices.resize(offset);
+        for(const auto& range : ranges)
+            forEachCluster(range, [&](size_t cluster) { indices[grid[cluster * 4]++] = range.light; });
+        // The offsets were moved to the end of their clusters so we move them back
+        for(size_t cluster = 0; cluster < clusterCount; cluster++)
+            grid[cluster * 4] -= grid[cluster * 4 + 1] + grid[cluster * 4 + 2];
+
+        lightData->update(lightTexels.data(), lightTexels.size() * sizeof(glm::vec4));
+        clusterGrid->update(grid.data(), grid.size() * sizeof(std::uint32_t));
+        clusterLights->update(indices.data(), indices.size() * sizeof(std::uint32_t));
+    }
+
+    void LightClusters::bind() const {
+        lightData->bind(TEXTURE_UNIT_LIGHT_DATA);
+        clusterGrid->bind(TEXTURE_UNIT_CLUSTER_GRID);
+        clusterLights->bind(TEXTURE_UNIT_CLUSTER_LIGHTS);
+    }
+
+}
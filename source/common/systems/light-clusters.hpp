@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../components/light.hpp"
+#include "../shader/texture-buffer.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace our {
+
+    // The view frustum is split into a grid of clusters (froxels): CLUSTER_COUNT_X x CLUSTER_COUNT_Y tiles on the screen
+    // and CLUSTER_COUNT_Z slices along the camera forward. The slices are exponentially distributed between the near and far planes
+    // so that the clusters have roughly the same proportions at any depth
+    // These must match the values in "light.frag"
+    #define CLUSTER_COUNT_X 16
+    #define CLUSTER_COUNT_Y 9
+    #define CLUSTER_COUNT_Z 24
+    // The number of RGBA32F texels holding the data of a single light in the light data buffer texture
+    #define LIGHT_DATA_TEXELS 4
+    // A light stops affecting a cluster once its attenuated intensity falls below this value
+    #define LIGHT_CUTOFF (1.0f / 256.0f)
+
+    // Assigns the lights to the clusters they can reach every frame and uploads the result to buffer textures
+    // so that each fragment only shades the lights of its own cluster:
+    // - "light_data" holds the lights. The global lights (the directional lights and the lights that never fade out) come first,
+    //   since they affect every fragment they are not assigned to any cluster. The baked directional lights (see "LightBaker") are the first of all
+    // - "cluster_grid" holds for every cluster the offset of its lights in "cluster_lights", its point light count and its spot light count
+    // - "cluster_lights" holds the indices of the lights of all the clusters, one cluster after the other
+    //   (the point lights of a cluster come before its spot lights so the shader can loop over each type without branching)
+    class LightClusters {
+        TextureBuffer *lightData = nullptr, *clusterGrid = nullptr, *clusterLights = nullptr;
+        // The CPU side of the buffer textures (kept to avoid reallocating them every frame)
+        std::vector<glm::vec4> lightTexels;
+        std::vector<std::uint32_t> grid;
+        std::vector<std::uint32_t> indices;
+        // The clusters reached by every light that is not global
+        struct ClusterRange {
+            std::uint32_t light;
+            int type;
+            int x0, x1, y0, y1, z0, z1;
+        };
+        std::vector<ClusterRange> ranges;
+        std::uint32_t lightCount = 0, globalLightCount = 0, directionalLightCount = 0, bakedLightCount = 0;
+        // The number of point and spot lights that were assigned to at least one cluster
+        std::uint32_t pointLightCount = 0, spotLightCount = 0;
+        // The defines of the light shader variant for this frame (see "getShaderDefines")
+        std::string shaderDefines;
+        float zScale = 0, zBias = 0;
+
+        // Appends the texels of the light to "lightTexels"
+        void addLight(const LightComponent* light);
+    public:
+        void initialize();
+        void destroy();
+
+        // Builds the clusters for the given camera and uploads them
+        // The depth of a point is its distance along "cameraForward" from "cameraPosition"
+        void update(const std::vector<LightComponent*>& lights, const glm::mat4& VP, const glm::vec3& cameraPosition,
+            const glm::vec3& cameraForward, float near, float far);
+
+        // Binds the buffer textures to their texture units (see "texture_buffer_bindings")
+        void bind() const;
+
+        // The slice of a depth is floor(log(depth) * zScale + zBias)
+        float getZScale() const { return zScale; }
+        float getZBias() const { return zBias; }
+        std::uint32_t getLightCount() const { return lightCount; }
+        std::uint32_t getGlobalLightCount() const { return globalLightCount; }
+        std::uint32_t getDirectionalLightCount() const { return directionalLightCount; }
+        std::uint32_t getBakedLightCount() const { return bakedLightCount; }
+
+        // Returns the defines that specialize the light shader for the lights of this frame
+        // (the number of directional lights, how many of them are baked and whether there are any clustered point or spot lights)
+        // Frames with the same light counts give the same defines, so the variants compiled from them are reused
+        const std::string& getShaderDefines() const { return shaderDefines; }
+        // The total number of light indices in all the clusters (a light is counted once for every cluster it reaches)
+        size_t getAssignmentCount() const { return indices.size(); }
+
+        // Returns the distance after which the light intensity falls below LIGHT_CUTOFF (or a negative value if it never does)
+        static float getRange(const LightComponent* light);
+    };
+
+}
@@ -0,0 +1,96 @@
+#include "occlusion-culling.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace our {
+
+    void OcclusionCuller::initialize() {
+        std::vector<Vertex> vertices;
+        for(int index = 0; index < 8; index++){
+            Vertex vertex{};
+            vertex.position = glm::vec3((index & 1) ? 1 : -1, (index & 2) ? 1 : -1, (index & 4) ? 1 : -1);
+            vertices.push_back(vertex);
+        }
+        // Two triangles for each face, the winding does not matter since the boxes are drawn without face culling
+        std::vector<unsigned int> elements = {
+            0, 1, 3,  0, 3, 2, // -z
+            4, 5, 7,  4, 7, 6, // +z
+            0, 1, 5,  0, 5, 4, // -y
+            2, 3, 7,  2, 7, 6, // +y
+            0, 2, 6,  0, 6, 4, // -x
+            1, 3, 7,  1, 7, 5, // +x
+        };
+        box = new Mesh(vertices, elements);
+
+        shader = new ShaderProgram();
+        shader->attach("assets/shaders/occlusion-box.vert", GL_VERTEX_SHADER);
+        shader->attach("assets/shaders/occlusion-box.frag", GL_FRAGMENT_SHADER);
+        shader->link();
+        transformLocation = shader->getUniformLocation("transform");
+
+        pipelineState.depthTesting.enabled = true;
+        pipelineState.depthTesting.function = GL_LEQUAL;
+        pipelineState.colorMask = {false, false, false, false};
+        pipelineState.depthMask = false;
+    }
+
+    void OcclusionCuller::destroy() {
+        delete box;
+        delete shader;
+        box = nullptr;
+        shader = nullptr;
+        if(!freeQueries.empty()) glDeleteQueries((GLsizei)freeQueries.size(), freeQueries.data());
+        freeQueries.clear();
+    }
+
+    bool OcclusionCuller::collect(OcclusionState& state) {
+        while(state.pending > 0){
+            // The oldest query in flight is read first since the queries finish in the order they were issued
+            GLuint query = state.queries[(state.next + OCCLUSION_QUERY_LATENCY - state.pending) % OCCLUSION_QUERY_LATENCY];
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available) break;
+            GLuint passed = GL_FALSE;
+            glGetQueryObjectuiv(query, GL_QUERY_RESULT, &passed);
+            state.occluded = !passed;
+            state.pending--;
+        }
+        return state.occluded;
+    }
+
+    void OcclusionCuller::begin() {
+        pipelineState.setup();
+        shader->use();
+    }
+
+    void OcclusionCuller::query(OcclusionState& state, const glm::mat4& transform) {
+        if(state.pending == OCCLUSION_QUERY_LATENCY) return;
+        GLuint& query = state.queries[state.next];
+        if(query == 0){
+            if(freeQueries.empty()){
+                glGenQueries(1, &query);
+            } else {
+                query = freeQueries.back();
+                freeQueries.pop_back();
+            }
+        }
+        glUniformMatrix4fv(transformLocation, 1, false, &transform[0][0]);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, query);
+        box->draw();
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        state.next = (state.next + 1) % OCCLUSION_QUERY_LATENCY;
+        state.pending++;
+    }
+
+    void OcclusionCuller::release(OcclusionState& state) {
+        for(GLuint& query : state.queries){
+            if(query != 0) freeQueries.push_back(query);
+            query = 0;
+        }
+        state = OcclusionState{};
+    }
+
+    glm::mat4 OcclusionCuller::boxTransform(const glm::vec3& minimum, const glm::vec3& maximum) {
+        return glm::scale(glm::translate(glm::mat4(1.0f), (minimum + maximum) * 0.5f), (maximum - minimum) * 0.5f);
+    }
+
+}
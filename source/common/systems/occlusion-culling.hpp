@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../mesh/mesh.hpp"
+#include "../shader/shader.hpp"
+#include "../material/pipeline-state.hpp"
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+namespace our {
+
+    // The number of occlusion queries that an object can have in flight
+    // The result of a query is only read once the GPU says it is available, so it usually arrives 1 or 2 frames late.
+    // If all the queries of an object are still in flight, no new query is issued for it until one of them finishes
+    #define OCCLUSION_QUERY_LATENCY 3
+
+    // The occlusion queries of a single object and the last result that was read back
+    struct OcclusionState {
+        GLuint queries[OCCLUSION_QUERY_LATENCY] = {};
+        // The index of the query that will be issued next (the queries are used as a ring)
+        std::uint8_t next = 0;
+        // The number of issued queries whose result was not read yet
+        std::uint8_t pending = 0;
+        // True if no sample of the bounding box passed the depth test the last time it was tested
+        bool occluded = false;
+    };
+
+    // The occlusion culler draws the bounding boxes of the objects (without writing color or depth) inside GL_ANY_SAMPLES_PASSED queries
+    // If no sample of a box passes the depth test, the object is hidden behind what was already drawn and it can be skipped
+    // The results are never waited for, so an object that becomes visible may appear a few frames late
+    class OcclusionCuller {
+        // A cube from (-1,-1,-1) to (1,1,1) which is scaled to the bounding box of each object
+        Mesh* box = nullptr;
+        ShaderProgram* shader = nullptr;
+        GLint transformLocation = -1;
+        // Depth testing without writing anything and without face culling (so that the box is still tested if the camera is inside it)
+        PipelineState pipelineState;
+        // Query objects that are not used by any object
+        std::vector<GLuint> freeQueries;
+    public:
+        void initialize();
+        void destroy();
+
+        // Reads the results of the queries of the object that are available (without waiting for the others)
+        // Returns true if the object is occluded according to the latest available result
+        bool collect(OcclusionState& state);
+
+        // Sets up the pipeline and the shader for the box draws
+        void begin();
+        // Draws the box transformed by "transform" (which maps the cube to the bounding box in clip space) inside a new query
+        // Does nothing if all the queries of the object are in flight
+        void query(OcclusionState& state, const glm::mat4& transform);
+
+        // Returns the query objects of the state to the culler (its results are discarded)
+        void release(OcclusionState& state);
+
+        // Returns the matrix that maps the cube to the given box
+        static glm::mat4 boxTransform(const glm::vec3& minimum, const glm::vec3& maximum);
+    };
+
+}
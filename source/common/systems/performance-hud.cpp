@@ -0,0 +1,157 @@
+#include "performance-hud.hpp"
+#include "../asset-loader.hpp"
+#include "../shader/shader.hpp"
+#include "../texture/texture2d.hpp"
+#include "../texture/texture-cube.hpp"
+#include "../shader/texture-buffer.hpp"
+#include "../texture/sampler.hpp"
+#include "../mesh/mesh.hpp"
+#include "../mesh/geometry-buffer.hpp"
+#include "../material/material.hpp"
+#include "../material/pipeline-state.hpp"
+#include "gl-call-counter.hpp"
+
+#include <imgui.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace our
+{
+
+    namespace
+    {
+        struct SystemTime {
+            const char *name;
+            float time;
+        };
+
+        bool visible = false;
+        World *world = nullptr;
+        float frameTimes[PERFORMANCE_HUD_HISTORY] = {};
+        size_t nextFrameTime = 0, frameTimeCount = 0;
+        // Kept between frames so that computing the percentiles does not allocate
+        std::vector<float> sortedFrameTimes;
+        std::vector<SystemTime> systemTimes;
+        size_t drawCalls = 0, drawnTriangles = 0, textureBinds = 0;
+
+        float getPercentile(float percentile)
+        {
+            size_t index = std::min((size_t)(percentile * sortedFrameTimes.size()), sortedFrameTimes.size() - 1);
+            return sortedFrameTimes[index];
+        }
+    }
+
+    void PerformanceHud::initialize(const nlohmann::json &config)
+    {
+        visible = config.is_object() && config.value("visible", false);
+        sortedFrameTimes.reserve(PERFORMANCE_HUD_HISTORY);
+    }
+
+    bool PerformanceHud::isVisible() { return visible; }
+
+    void PerformanceHud::toggle()
+    {
+        visible = !visible;
+        // The system times are only measured while visible so they start over
+        systemTimes.clear();
+    }
+
+    void PerformanceHud::setWorld(World *newWorld) { world = newWorld; }
+
+    void PerformanceHud::recordFrameTime(float frameTime)
+    {
+        frameTimes[nextFrameTime] = frameTime;
+        nextFrameTime = (nextFrameTime + 1) % PERFORMANCE_HUD_HISTORY;
+        frameTimeCount = std::min(frameTimeCount + 1, (size_t)PERFORMANCE_HUD_HISTORY);
+    }
+
+    void PerformanceHud::recordSystemTime(const char *name, float time)
+    {
+        for (auto &system : systemTimes)
+        {
+            if (system.name == name || std::strcmp(system.name, name) == 0)
+            {
+                // The times are smoothed so that they can be read
+                system.time += (time - system.time) * 0.1f;
+                return;
+            }
+        }
+        systemTimes.push_back({name, time});
+    }
+
+    void PerformanceHud::endFrame()
+    {
+        drawCalls = Mesh::drawCalls;
+        drawnTriangles = Mesh::drawnTriangles;
+        textureBinds = Texture2D::bindCount;
+        Mesh::drawCalls = Mesh::drawnTriangles = 0;
+        Texture2D::bindCount = 0;
+    }
+
+    void PerformanceHud::draw()
+    {
+        if (!visible)
+            return;
+
+        ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowBgAlpha(0.6f);
+        ImGui::Begin("Performance", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing);
+
+        if (frameTimeCount > 0)
+        {
+            sortedFrameTimes.assign(frameTimes, frameTimes + frameTimeCount);
+            std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+            // The oldest frame is right after the newest one once the history is full
+            size_t offset = frameTimeCount == PERFORMANCE_HUD_HISTORY ? nextFrameTime : 0;
+            ImGui::PlotLines("##frame-times", frameTimes, (int)frameTimeCount, (int)offset, "Frame time (ms)",
+                             0.0f, std::max(33.3f, sortedFrameTimes.back()), ImVec2(300, 60));
+            ImGui::Text("p50: %.2f ms  p95: %.2f ms  p99: %.2f ms  max: %.2f ms",
+                        getPercentile(0.5f), getPercentile(0.95f), getPercentile(0.99f), sortedFrameTimes.back());
+        }
+
+        if (!systemTimes.empty())
+        {
+            ImGui::Separator();
+            for (const auto &system : systemTimes)
+                ImGui::Text("%-20s %7.3f ms", system.name, system.time);
+        }
+
+        ImGui::Separator();
+        const PipelineState::Statistics &stateStatistics = PipelineState::getStatistics();
+        ImGui::Text("Draw calls: %d  Triangles: %d", (int)drawCalls, (int)drawnTriangles);
+        ImGui::Text("State changes: %d  Texture binds: %d", (int)stateStatistics.issuedCalls, (int)textureBinds);
+        if (GLCallCounter::isEnabled())
+        {
+            // What actually reached the driver in the last frame (only counted in debug builds)
+            const GLCallStatistics &calls = GLCallCounter::getLastFrame();
+            ImGui::Text("GL calls: %d  (draws %d, programs %d, uniforms %d)", (int)calls.getTotal(),
+                        (int)calls.drawCalls, (int)calls.programBinds, (int)calls.uniformUploads);
+            ImGui::Text("  textures %d, samplers %d, buffers %d, state %d", (int)calls.textureBinds,
+                        (int)calls.samplerBinds, (int)calls.bufferUploads, (int)calls.stateToggles);
+        }
+
+        if (world)
+        {
+            size_t components = 0;
+            for (auto entity : world->getEntities())
+                components += entity->getComponentCount();
+            ImGui::Text("Entities: %d  Components: %d", (int)world->getEntities().size(), (int)components);
+        }
+
+        ImGui::Separator();
+        ImGui::Text("Shaders: %d  Textures: %d  Samplers: %d  Meshes: %d  Materials: %d",
+                    (int)AssetLoader<ShaderProgram>::getAll().size(), (int)AssetLoader<Texture2D>::getAll().size(),
+                    (int)AssetLoader<Sampler>::getAll().size(), (int)AssetLoader<Mesh>::getAll().size(),
+                    (int)AssetLoader<Material>::getAll().size());
+        // The textures count both the loaded images and the render targets (the scene, G-buffer, weighted blended and pooled targets)
+        size_t textureMemory = Texture2D::totalMemoryUsage, cubemapMemory = TextureCube::totalMemoryUsage;
+        size_t bufferTextureMemory = TextureBuffer::totalMemoryUsage, geometryMemory = GeometryBuffer::getMemoryUsage();
+        ImGui::Text("Estimated VRAM: %.1f MB", (textureMemory + cubemapMemory + bufferTextureMemory + geometryMemory) / 1048576.0f);
+        ImGui::Text("  textures %.1f MB, cubemaps %.1f MB, buffer textures %.1f MB, geometry %.1f MB", textureMemory / 1048576.0f,
+                    cubemapMemory / 1048576.0f, bufferTextureMemory / 1048576.0f, geometryMemory / 1048576.0f);
+
+        ImGui::End();
+    }
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+#include "cpu-tracer.hpp"
+
+#include <json/json.hpp>
+
+namespace our
+{
+
+    // The number of frames shown in the frame time graph (and from which the percentiles are computed)
+    #define PERFORMANCE_HUD_HISTORY 240
+
+    // The performance HUD is an ImGui overlay (toggled with F3) showing the health of the engine:
+    // the frame time graph and percentiles, the CPU time of the systems, the draw calls, triangles, pipeline state changes
+    // and texture binds of the last frame, the entity and component counts of the world, the loaded assets and an estimate of the VRAM.
+    // While it is hidden, it only stores the frame time and resets the frame counters, so it can stay in every build
+    // Like the pipeline state cache, the HUD is shared by the whole application
+    class PerformanceHud {
+    public:
+        // Reads the "performanceHud" object of the application config ({"visible": false})
+        static void initialize(const nlohmann::json& config);
+
+        static bool isVisible();
+        static void toggle();
+
+        // Sets the world whose entities and components are counted (nullptr when there is none)
+        static void setWorld(World* world);
+
+        // Stores the time of a frame (in milliseconds)
+        static void recordFrameTime(float frameTime);
+        // Stores the CPU time of a system in this frame (in milliseconds). The name must outlive the HUD (a string literal)
+        static void recordSystemTime(const char* name, float time);
+        // Takes the counters of the frame that just ended (draw calls, triangles, texture binds) and resets them
+        static void endFrame();
+
+        // Shows the overlay (if it is visible)
+        static void draw();
+    };
+
+    // Measures the CPU time of the system update in the scope in which it lives: it is recorded in the CPU trace (if the tracer is enabled)
+    // and shown by the HUD (while it is visible). The clock is only read if one of them needs it (see "TRACE_SYSTEM")
+    class SystemTimer {
+        const char* name;
+        bool timed, traced;
+        int64_t start = 0;
+    public:
+        explicit SystemTimer(const char* name) : name(name), timed(PerformanceHud::isVisible()), traced(CpuTracer::isEnabled()) {
+            if (timed || traced) start = CpuTracer::now();
+        }
+        ~SystemTimer() {
+            if (!timed && !traced) return;
+            int64_t end = CpuTracer::now();
+            if (traced) CpuTracer::record(name, start, end);
+            if (timed) PerformanceHud::recordSystemTime(name, (end - start) * 1e-6f);
+        }
+
+        SystemTimer(const SystemTimer&) = delete;
+        SystemTimer& operator=(const SystemTimer&) = delete;
+    };
+
+}
+
+// Times the rest of the current scope as a system update (a string literal) for both the CPU trace and the performance HUD
+#define TRACE_SYSTEM(name) our::SystemTimer CPU_TRACE_CONCATENATE(systemTimer, __LINE__)(name)
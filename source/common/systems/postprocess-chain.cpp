@@ -0,0 +1,244 @@
+#include "postprocess-chain.hpp"
+#include "../mesh/geometry-buffer.hpp"
+
+#include <iostream>
+#include <string>
+
+namespace our
+{
+
+    // The uniforms through which an effect reads the weight of every condition (indexed by "PostprocessCondition")
+    static const char *CONDITION_WEIGHT_UNIFORMS[(int)PostprocessCondition::COUNT] = {
+        nullptr, "normal_weight", "increase_speed_weight", "collision_weight"};
+
+    PostprocessCondition PostprocessChain::parseCondition(const std::string &condition)
+    {
+        if (condition == "always")
+            return PostprocessCondition::ALWAYS;
+        if (condition == "normal")
+            return PostprocessCondition::NORMAL;
+        if (condition == "increaseSpeed")
+            return PostprocessCondition::INCREASE_SPEED;
+        if (condition == "collision")
+            return PostprocessCondition::COLLISION;
+        std::cerr << "Unknown postprocess condition \"" << condition << "\", the effect will always run" << std::endl;
+        return PostprocessCondition::ALWAYS;
+    }
+
+    void PostprocessChain::initialize(const nlohmann::json &config, float fadeTime)
+    {
+        this->fadeTime = fadeTime;
+        conditionWeights[(int)PostprocessCondition::ALWAYS] = 1.0f;
+        conditionWeights[(int)PostprocessCondition::NORMAL] = 1.0f;
+        conditionWeights[(int)PostprocessCondition::INCREASE_SPEED] = 0.0f;
+        conditionWeights[(int)PostprocessCondition::COLLISION] = 0.0f;
+        startTime = lastApplyTime = std::chrono::steady_clock::now();
+
+        // A single shader path is a chain of one effect which always runs
+        nlohmann::json list = config.is_string() ? nlohmann::json::array({{{"shader", config}}}) : config;
+        if (!list.is_array())
+            return;
+
+        for (const auto &effectConfig : list)
+        {
+            if (!effectConfig.is_object())
+                continue;
+            PostprocessEffect effect;
+            effect.pyramidLevels = glm::clamp(effectConfig.value("pyramid", 0), 0, MAX_BLUR_PYRAMID_LEVELS);
+            std::string defines = effect.pyramidLevels > 0 ? "#define BLUR_PYRAMID\n" : "";
+            effect.shader = new ShaderProgram();
+            effect.shader->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
+            effect.shader->attach(effectConfig.value<std::string>("shader", ""), GL_FRAGMENT_SHADER, defines);
+            effect.shader->link();
+            effect.shader->use();
+            effect.shader->set("tex", (GLint)0);
+            if (effect.pyramidLevels > 0)
+            {
+                effect.shader->set("blurred", (GLint)1);
+                effect.pyramidScaleLocation = effect.shader->getUniformLocation("pyramid_scale");
+                if (!downsampleShader)
+                {
+                    downsampleShader = new ShaderProgram();
+                    downsampleShader->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
+                    downsampleShader->attach("assets/shaders/postprocess/downsample.frag", GL_FRAGMENT_SHADER);
+                    downsampleShader->link();
+                    downsampleShader->use();
+                    downsampleShader->set("tex", (GLint)0);
+                    downsampleTexelSizeLocation = downsampleShader->getUniformLocation("texel_size");
+                }
+            }
+            for (int condition = 0; condition < (int)PostprocessCondition::COUNT; ++condition)
+                effect.conditionWeightLocations[condition] =
+                    CONDITION_WEIGHT_UNIFORMS[condition] ? effect.shader->getUniformLocation(CONDITION_WEIGHT_UNIFORMS[condition]) : -1;
+            effect.timeLocation = effect.shader->getUniformLocation("time");
+            effect.scale = effectConfig.value("scale", 1.0f);
+            effect.condition = parseCondition(effectConfig.value<std::string>("when", "always"));
+            effect.pyramidCondition = parseCondition(effectConfig.value<std::string>("pyramidWhen", "always"));
+            effects.push_back(effect);
+        }
+        if (effects.empty())
+            return;
+        activeEffects.reserve(effects.size());
+
+        // The effects are sampled with bilinear filtering so that the outputs of the downscaled effects are smoothly upscaled
+        sampler = new Sampler();
+        sampler->set(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        sampler->set(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        sampler->set(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        sampler->set(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        // The default options are fine but we don't need to interact with the depth buffer
+        // so it is more performant to disable the depth mask
+        pipelineState.depthMask = false;
+
+        // The fullscreen triangle is generated in the vertex shader, so the vertex array has no attributes
+        glGenVertexArrays(1, &vertexArray);
+    }
+
+    void PostprocessChain::destroy()
+    {
+        for (auto &effect : effects)
+            delete effect.shader;
+        effects.clear();
+        activeEffects.clear();
+        delete downsampleShader;
+        downsampleShader = nullptr;
+        targetPool.destroy();
+        delete sampler;
+        sampler = nullptr;
+        if (vertexArray)
+            glDeleteVertexArrays(1, &vertexArray);
+        vertexArray = 0;
+    }
+
+    RenderTarget *PostprocessChain::buildPyramid(Texture2D *input, glm::ivec2 inputSize, int levels)
+    {
+        downsampleShader->use();
+        RenderTarget *previous = nullptr;
+        for (int level = 0; level < levels; ++level)
+        {
+            glm::ivec2 size = glm::max(inputSize / 2, glm::ivec2(1));
+            RenderTarget *target = targetPool.acquire(GL_RGBA8, size);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target->framebuffer);
+            glViewport(0, 0, size.x, size.y);
+            downsampleShader->set(downsampleTexelSizeLocation, 1.0f / glm::vec2(inputSize));
+            input->bind();
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            // Only the smallest level is sampled by the effect, so every other level can be reused right away
+            targetPool.release(previous);
+            previous = target;
+            input = target->texture;
+            inputSize = size;
+        }
+        return previous;
+    }
+
+    void PostprocessChain::updateWeights(bool increaseSpeedEffect, bool collisionEffect)
+    {
+        auto now = std::chrono::steady_clock::now();
+        float deltaTime = std::chrono::duration<float>(now - lastApplyTime).count();
+        lastApplyTime = now;
+
+        bool targets[(int)PostprocessCondition::COUNT] = {true, !increaseSpeedEffect && !collisionEffect, increaseSpeedEffect, collisionEffect};
+        float step = fadeTime > 0.0f ? deltaTime / fadeTime : 1.0f;
+        for (int condition = 0; condition < (int)PostprocessCondition::COUNT; ++condition)
+        {
+            float &weight = conditionWeights[condition];
+            weight = targets[condition] ? glm::min(weight + step, 1.0f) : glm::max(weight - step, 0.0f);
+        }
+    }
+
+    void PostprocessChain::apply(Texture2D *scene, GLuint sceneFramebuffer, glm::ivec2 sceneSize, glm::ivec2 windowSize,
+                                 bool increaseSpeedEffect, bool collisionEffect)
+    {
+        updateWeights(increaseSpeedEffect, collisionEffect);
+        float time = std::chrono::duration<float>(lastApplyTime - startTime).count();
+
+        activeEffects.clear();
+        for (const auto &effect : effects)
+            if (getConditionWeight(effect.condition) > 0.0f)
+                activeEffects.push_back(&effect);
+
+        if (activeEffects.empty())
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, sceneSize.x, sceneSize.y, 0, 0, windowSize.x, windowSize.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            // The window is read back after the frame (e.g. by the screenshots), so it is made the read framebuffer again
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+            targetPool.endFrame();
+            return;
+        }
+
+        Texture2D *input = scene;
+        glm::ivec2 inputSize = sceneSize;
+        RenderTarget *inputTarget = nullptr;
+        if (sceneSize != windowSize)
+        {
+            // The effects sample their whole input, so the part of the scene that was drawn is copied into a target of its own
+            inputTarget = targetPool.acquire(GL_RGBA8, sceneSize);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, inputTarget->framebuffer);
+            glBlitFramebuffer(0, 0, sceneSize.x, sceneSize.y, 0, 0, sceneSize.x, sceneSize.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+            input = inputTarget->texture;
+        }
+
+        pipelineState.setup();
+        glBindVertexArray(vertexArray);
+        GeometryBuffer::invalidateBinding();
+        glActiveTexture(GL_TEXTURE0);
+        sampler->bind(0);
+
+        for (size_t index = 0; index < activeEffects.size(); ++index)
+        {
+            const PostprocessEffect *effect = activeEffects[index];
+            RenderTarget *pyramidTarget = nullptr;
+            if (effect->pyramidLevels > 0 && getConditionWeight(effect->pyramidCondition) > 0.0f)
+                pyramidTarget = buildPyramid(input, inputSize, glm::clamp(effect->pyramidLevels + pyramidBias, 1, MAX_BLUR_PYRAMID_LEVELS));
+
+            RenderTarget *outputTarget = nullptr;
+            glm::ivec2 outputSize = windowSize;
+            if (index + 1 == activeEffects.size())
+            {
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            }
+            else
+            {
+                outputSize = glm::max(glm::ivec2(glm::vec2(windowSize) * effect->scale), glm::ivec2(1));
+                outputTarget = targetPool.acquire(GL_RGBA8, outputSize);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputTarget->framebuffer);
+            }
+            glViewport(0, 0, outputSize.x, outputSize.y);
+
+            effect->shader->use();
+            for (int condition = 0; condition < (int)PostprocessCondition::COUNT; ++condition)
+                if (effect->conditionWeightLocations[condition] >= 0)
+                    effect->shader->set(effect->conditionWeightLocations[condition], conditionWeights[condition]);
+            if (effect->timeLocation >= 0)
+                effect->shader->set(effect->timeLocation, time);
+            input->bind();
+            if (pyramidTarget)
+            {
+                effect->shader->set(effect->pyramidScaleLocation, (GLfloat)inputSize.x / pyramidTarget->size.x);
+                glActiveTexture(GL_TEXTURE1);
+                pyramidTarget->texture->bind();
+                sampler->bind(1);
+                glActiveTexture(GL_TEXTURE0);
+            }
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+
+            // The input (and the pyramid) is not needed anymore, so the effect after the next one can draw into it
+            targetPool.release(inputTarget);
+            targetPool.release(pyramidTarget);
+            inputTarget = outputTarget;
+            if (outputTarget)
+            {
+                input = outputTarget->texture;
+                inputSize = outputSize;
+            }
+        }
+        targetPool.endFrame();
+    }
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "render-target-pool.hpp"
+#include "../shader/shader.hpp"
+#include "../texture/sampler.hpp"
+#include "../material/pipeline-state.hpp"
+
+#include <json/json.hpp>
+#include <chrono>
+#include <vector>
+
+namespace our
+{
+
+    // The most levels that a blur pyramid can have (each one is half the size of the previous one)
+    #define MAX_BLUR_PYRAMID_LEVELS 4
+
+    // When a postprocess effect runs (the flags are the ones given to "ForwardRenderer::render")
+    // Every condition has a weight which fades toward 1 while the condition holds and toward 0 otherwise,
+    // and an effect runs as long as the weight of its condition is above 0
+    enum class PostprocessCondition {
+        ALWAYS,
+        // Only when neither the increase speed nor the collision effect is on
+        NORMAL,
+        INCREASE_SPEED,
+        COLLISION,
+        COUNT
+    };
+
+    struct PostprocessEffect {
+        // A program made of "fullscreen.vert" and the effect fragment shader which samples the previous effect from "tex"
+        ShaderProgram* shader = nullptr;
+        // The size of the output of the effect relative to the window
+        // (ignored by the last effect of a frame since it draws directly into the window)
+        float scale = 1.0f;
+        PostprocessCondition condition = PostprocessCondition::ALWAYS;
+        // If not 0, the input of the effect is downsampled this many times (to half, quarter, ... of its size) before the effect runs
+        // and the smallest level is bound to "blurred" so that blur effects can take a few taps from it instead of many full size taps
+        // The shader is then compiled with BLUR_PYRAMID defined and "pyramid_scale" holds the size of the input over the size of "blurred"
+        int pyramidLevels = 0;
+        GLint pyramidScaleLocation = -1;
+        // The pyramid is only built while the weight of this condition is above 0 (e.g. only while an uber effect blurs)
+        PostprocessCondition pyramidCondition = PostprocessCondition::ALWAYS;
+        // The locations of the condition weights ("normal_weight", "increase_speed_weight", "collision_weight") and of "time"
+        // which let an effect fade its parts in and out (-1 if the shader does not use them)
+        GLint conditionWeightLocations[(int)PostprocessCondition::COUNT];
+        GLint timeLocation = -1;
+    };
+
+    // The postprocess chain runs an ordered list of fullscreen effects on the scene color.
+    // Every effect reads the output of the previous active one, the intermediate outputs are taken from a render target pool
+    // and the last active effect draws directly into the default framebuffer (so a single effect needs no extra target)
+    class PostprocessChain {
+        std::vector<PostprocessEffect> effects;
+        // The effects that run in the current frame (a member so that it is not allocated every frame)
+        std::vector<const PostprocessEffect*> activeEffects;
+        RenderTargetPool targetPool;
+        Sampler* sampler = nullptr;
+        PipelineState pipelineState;
+        GLuint vertexArray = 0;
+        // The shader which draws every level of the blur pyramids (only created if an effect has a pyramid)
+        ShaderProgram* downsampleShader = nullptr;
+        GLint downsampleTexelSizeLocation = -1;
+        // The current weight of every condition and the time (in seconds) it takes a weight to go from 0 to 1
+        float conditionWeights[(int)PostprocessCondition::COUNT] = {1.0f, 1.0f, 0.0f, 0.0f};
+        float fadeTime = 0.0f;
+        // The number of levels added to every blur pyramid (to trade the blur quality for speed)
+        int pyramidBias = 0;
+        // When the chain was created and last applied (to animate the weights and send "time")
+        std::chrono::steady_clock::time_point startTime, lastApplyTime;
+
+        // Moves the condition weights toward the given flags
+        void updateWeights(bool increaseSpeedEffect, bool collisionEffect);
+
+        // Draws the pyramid of the given input and returns its smallest level (which the caller must release)
+        RenderTarget* buildPyramid(Texture2D* input, glm::ivec2 inputSize, int levels);
+
+        static PostprocessCondition parseCondition(const std::string& condition);
+    public:
+        // Reads the chain from the "postprocess" value of the renderer config which is either the path of a single fragment shader
+        // or an ordered list of effects: {"shader": path, "scale": 1.0, "when": "always" | "normal" | "increaseSpeed" | "collision",
+        //                                  "pyramid": 0, "pyramidWhen": "always" | ...}
+        // "fadeTime" is how long (in seconds) the effects take to fade in and out when their condition changes (0 is a hard cut)
+        void initialize(const nlohmann::json& config, float fadeTime = 0.0f);
+        // Deletes the effects and the pooled targets
+        void destroy();
+
+        // Returns true if the chain has at least one effect (so the scene must be drawn into a texture)
+        bool isEnabled() const { return !effects.empty(); }
+
+        // Adds the given number of levels to every blur pyramid (see "QualityLevel::postprocessQuality")
+        void setPyramidBias(int bias) { pyramidBias = bias; }
+
+        // Runs the active effects on "scene" (the color attachment of "sceneFramebuffer") ending in the default framebuffer
+        // The scene may only cover its bottom left "sceneSize" pixels (when it is drawn at a lower resolution than the window)
+        // in which case it is first copied to a target of that size that the first effect upscales to the window
+        // If no effect is active in this frame, the scene is simply copied (and upscaled) to the default framebuffer
+        void apply(Texture2D* scene, GLuint sceneFramebuffer, glm::ivec2 sceneSize, glm::ivec2 windowSize,
+                   bool increaseSpeedEffect, bool collisionEffect);
+
+        // Returns the current weight of the given condition
+        float getConditionWeight(PostprocessCondition condition) const { return conditionWeights[(int)condition]; }
+
+        // Returns the pool of the intermediate targets
+        const RenderTargetPool& getTargetPool() const { return targetPool; }
+    };
+
+}
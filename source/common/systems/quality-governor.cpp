@@ -0,0 +1,107 @@
+#include "quality-governor.hpp"
+
+#include <imgui.h>
+#include <algorithm>
+
+namespace our
+{
+
+    void QualityLevel::deserialize(const nlohmann::json &data)
+    {
+        if (!data.is_object())
+            return;
+        renderScale = std::clamp(data.value("renderScale", renderScale), 0.25f, 1.0f);
+        postprocessQuality = std::clamp(data.value("postprocessQuality", postprocessQuality), 0, 2);
+        maxLights = std::max(data.value("maxLights", maxLights), 0);
+    }
+
+    void QualityGovernor::deserialize(const nlohmann::json &data)
+    {
+        levels.clear();
+        currentLevel = 0;
+        overBudgetFrames = underBudgetFrames = 0;
+        smoothedFrameTime = 0.0f;
+        if (!data.is_object())
+        {
+            enabled = false;
+            return;
+        }
+        enabled = data.value("enabled", true);
+        overlay = data.value("overlay", false);
+        targetFrameTime = data.value("targetFrameTime", targetFrameTime);
+        downgradeThreshold = data.value("downgradeThreshold", downgradeThreshold);
+        upgradeThreshold = data.value("upgradeThreshold", upgradeThreshold);
+        downgradeFrames = data.value("downgradeFrames", downgradeFrames);
+        upgradeFrames = data.value("upgradeFrames", upgradeFrames);
+        if (data.contains("levels"))
+        {
+            for (const auto &levelData : data["levels"])
+            {
+                QualityLevel level;
+                level.deserialize(levelData);
+                levels.push_back(level);
+            }
+        }
+        // Without a ladder there is nothing to govern
+        if (levels.size() < 2)
+            enabled = false;
+    }
+
+    bool QualityGovernor::update(float cpuTime, float gpuTime)
+    {
+        this->cpuTime = cpuTime;
+        this->gpuTime = gpuTime;
+        if (!enabled)
+            return false;
+
+        // The frame is bound by the slowest of the two processors
+        float frameTime = std::max(cpuTime, gpuTime);
+        smoothedFrameTime = smoothedFrameTime == 0.0f ? frameTime : smoothedFrameTime + (frameTime - smoothedFrameTime) * QUALITY_GOVERNOR_SMOOTHING;
+
+        overBudgetFrames = smoothedFrameTime > targetFrameTime * downgradeThreshold ? overBudgetFrames + 1 : 0;
+        underBudgetFrames = smoothedFrameTime < targetFrameTime * upgradeThreshold ? underBudgetFrames + 1 : 0;
+
+        size_t level = currentLevel;
+        if (overBudgetFrames >= downgradeFrames && currentLevel + 1 < levels.size())
+            level = currentLevel + 1;
+        else if (underBudgetFrames >= upgradeFrames && currentLevel > 0)
+            level = currentLevel - 1;
+        if (level == currentLevel)
+            return false;
+
+        // The times measured so far belong to the old level, so the new one is judged from scratch
+        currentLevel = level;
+        overBudgetFrames = underBudgetFrames = 0;
+        smoothedFrameTime = 0.0f;
+        return true;
+    }
+
+    const QualityLevel &QualityGovernor::getLevel() const
+    {
+        static const QualityLevel defaultLevel;
+        return enabled ? levels[currentLevel] : defaultLevel;
+    }
+
+    void QualityGovernor::drawOverlay() const
+    {
+        const QualityLevel &level = getLevel();
+        ImGui::SetNextWindowPos(ImVec2(10, 100), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowBgAlpha(0.5f);
+        ImGui::Begin("Quality", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing);
+        ImGui::Text("CPU: %.2f ms  GPU: %.2f ms", cpuTime, gpuTime);
+        ImGui::Text("Target: %.2f ms  Smoothed: %.2f ms", targetFrameTime, smoothedFrameTime);
+        if (enabled)
+            ImGui::Text("Level: %d / %d", (int)currentLevel, (int)levels.size() - 1);
+        else
+            ImGui::TextDisabled("Governor disabled");
+        ImGui::Separator();
+        ImGui::Text("Render scale: %.2f", level.renderScale);
+        ImGui::Text("Postprocess quality: %d", level.postprocessQuality);
+        if (level.maxLights > 0)
+            ImGui::Text("Max lights: %d", level.maxLights);
+        else
+            ImGui::Text("Max lights: all");
+        ImGui::End();
+    }
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <json/json.hpp>
+#include <vector>
+
+namespace our
+{
+
+    // How much every new frame time moves the smoothed frame time that the governor compares with the target
+    #define QUALITY_GOVERNOR_SMOOTHING 0.1f
+
+    // The knobs of one quality level of the governor
+    struct QualityLevel {
+        // The size of the scene framebuffer relative to the window (the postprocess chain upscales it to the window)
+        float renderScale = 1.0f;
+        // 2 is full quality, every step below adds a level to the blur pyramids of the postprocess effects (see "PostprocessChain")
+        int postprocessQuality = 2;
+        // The most point and spot lights drawn in a frame, the nearest to the camera are kept (0 keeps all the lights)
+        int maxLights = 0;
+
+        void deserialize(const nlohmann::json& data);
+    };
+
+    // The quality governor watches the time the renderer takes on the CPU and on the GPU every frame
+    // and walks a ladder of quality levels (the first one is the best) to keep it under a target.
+    // It only steps down after the smoothed frame time stayed over the target for "downgradeFrames" frames in a row
+    // and only steps up after it stayed well under the target ("upgradeThreshold") for "upgradeFrames" frames in a row,
+    // so it does not oscillate between two levels when the frame time is close to the target
+    class QualityGovernor {
+        bool enabled = false;
+        // If true, the state of the governor is shown in an ImGui window (see "drawOverlay")
+        bool overlay = false;
+        // The frame time to stay under (in milliseconds) and the fractions of it at which the quality is lowered or raised
+        float targetFrameTime = 16.6f;
+        float downgradeThreshold = 1.0f, upgradeThreshold = 0.7f;
+        int downgradeFrames = 30, upgradeFrames = 120;
+        std::vector<QualityLevel> levels;
+        size_t currentLevel = 0;
+        // The last measured times (in milliseconds) and the number of frames in a row spent over/under the thresholds
+        float cpuTime = 0.0f, gpuTime = 0.0f, smoothedFrameTime = 0.0f;
+        int overBudgetFrames = 0, underBudgetFrames = 0;
+    public:
+        // Reads the governor from the "qualityGovernor" object of the renderer config
+        void deserialize(const nlohmann::json& data);
+
+        // Feeds the renderer times of a frame (in milliseconds) and returns true if the quality level changed
+        bool update(float cpuTime, float gpuTime);
+
+        bool isEnabled() const { return enabled; }
+        bool isOverlayEnabled() const { return overlay; }
+        // Returns the knobs of the current level (the default knobs if the governor is disabled)
+        const QualityLevel& getLevel() const;
+        size_t getLevelIndex() const { return currentLevel; }
+
+        // Shows the measured times and the current knobs in an ImGui window
+        void drawOverlay() const;
+    };
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+namespace our {
+
+    // Sorts "items" in ascending order of the 64-bit key returned by "key(item)" using an LSD radix sort
+    // The sort goes over the key one byte at a time starting from the least significant one, so it is stable and runs in O(8n)
+    // All the byte histograms are built in a single pass, and any byte that is the same for every item is skipped
+    // (which is common since the keys rarely use all of their bits)
+    // "scratch" is the temporary storage used for the passes, it is taken as a parameter so that it can be reused every frame
+    template<typename T, typename KeyFunction>
+    void radixSort(std::vector<T>& items, std::vector<T>& scratch, KeyFunction key) {
+        const size_t count = items.size();
+        if(count < 2) return;
+
+        size_t histograms[8][256];
+        std::memset(histograms, 0, sizeof(histograms));
+        for(const T& item : items){
+            std::uint64_t value = key(item);
+            for(int pass = 0; pass < 8; pass++)
+                histograms[pass][(value >> (pass * 8)) & 0xFF]++;
+        }
+
+        scratch.resize(count);
+        std::vector<T>* source = &items;
+        std::vector<T>* destination = &scratch;
+        for(int pass = 0; pass < 8; pass++){
+            size_t* histogram = histograms[pass];
+            // If all the items fall in the same bucket, this pass would not change the order
+            if(histogram[(key((*source)[0]) >> (pass * 8)) & 0xFF] == count) continue;
+
+            // Turn the histogram into the starting offset of each bucket
+            size_t offset = 0;
+            for(int bucket = 0; bucket < 256; bucket++){
+                size_t bucketSize = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucketSize;
+            }
+            for(T& item : *source)
+                (*destination)[histogram[(key(item) >> (pass * 8)) & 0xFF]++] = std::move(item);
+            std::swap(source, destination);
+        }
+        // If an odd number of passes ran, the sorted data is in the scratch vector
+        if(source != &items) items.swap(scratch);
+    }
+
+}
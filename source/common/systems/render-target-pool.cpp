@@ -0,0 +1,65 @@
+#include "render-target-pool.hpp"
+#include "../texture/texture-utils.hpp"
+
+#include <iostream>
+
+namespace our
+{
+
+    RenderTarget *RenderTargetPool::acquire(GLenum format, glm::ivec2 size)
+    {
+        for (auto target : targets)
+        {
+            if (target->used || target->format != format || target->size != size)
+                continue;
+            target->used = true;
+            target->lastUsedFrame = frame;
+            return target;
+        }
+
+        RenderTarget *target = new RenderTarget();
+        target->format = format;
+        target->size = size;
+        target->used = true;
+        target->lastUsedFrame = frame;
+        target->texture = texture_utils::empty(format, size);
+        glGenFramebuffers(1, &target->framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target->framebuffer);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->texture->getOpenGLName(), 0);
+        if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "A pooled render target is incomplete" << std::endl;
+        targets.push_back(target);
+        return target;
+    }
+
+    void RenderTargetPool::endFrame()
+    {
+        for (size_t index = 0; index < targets.size();)
+        {
+            RenderTarget *target = targets[index];
+            if (target->used || frame - target->lastUsedFrame < RENDER_TARGET_MAX_IDLE_FRAMES)
+            {
+                index++;
+                continue;
+            }
+            glDeleteFramebuffers(1, &target->framebuffer);
+            delete target->texture;
+            delete target;
+            targets[index] = targets.back();
+            targets.pop_back();
+        }
+        frame++;
+    }
+
+    void RenderTargetPool::destroy()
+    {
+        for (auto target : targets)
+        {
+            glDeleteFramebuffers(1, &target->framebuffer);
+            delete target->texture;
+            delete target;
+        }
+        targets.clear();
+    }
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../texture/texture2d.hpp"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace our
+{
+
+    // A free target which was not acquired for this many frames is deleted (e.g. the targets of an old resolution)
+    #define RENDER_TARGET_MAX_IDLE_FRAMES 120
+
+    // A color texture with the framebuffer that draws into it
+    struct RenderTarget {
+        Texture2D* texture = nullptr;
+        GLuint framebuffer = 0;
+        GLenum format = GL_RGBA8;
+        glm::ivec2 size = {0, 0};
+        // True while the target is acquired (between "acquire" and "release")
+        bool used = false;
+        // The frame in which the target was last acquired
+        size_t lastUsedFrame = 0;
+    };
+
+    // A pool of render targets which are reused by format and size
+    // A pass acquires its output and releases its input as soon as it no longer needs it, so the targets whose lifetimes
+    // do not overlap share the same texture (e.g. a chain of passes only ever needs two targets to ping-pong between)
+    // Targets are only created when no free target matches, so after the first frame nothing is allocated anymore
+    class RenderTargetPool {
+        std::vector<RenderTarget*> targets;
+        size_t frame = 0;
+    public:
+        // Returns a free target with the given format and size (creating it if there is none)
+        RenderTarget* acquire(GLenum format, glm::ivec2 size);
+        // Returns the target to the pool so that the next "acquire" can reuse it
+        void release(RenderTarget* target) { if (target) target->used = false; }
+        // Deletes the free targets that were not acquired for RENDER_TARGET_MAX_IDLE_FRAMES frames and starts a new frame
+        // The sizes only change when the resolution does, so this rarely deletes anything
+        void endFrame();
+        // Deletes all the targets (none of them should be used after this)
+        void destroy();
+
+        // Returns how many targets were created so far
+        size_t getTargetCount() const { return targets.size(); }
+    };
+
+}
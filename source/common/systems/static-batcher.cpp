@@ -0,0 +1,84 @@
+#include "static-batcher.hpp"
+#include "../asset-loader.hpp"
+
+#include <map>
+#include <tuple>
+#include <vector>
+#include <string>
+
+namespace our
+{
+
+    size_t StaticBatcher::batch(World *world)
+    {
+        if (!enabled)
+            return 0;
+
+        // Group the mesh renderers of the static entities by their parent, their material and their cell
+        using BatchKey = std::tuple<Entity *, Material *, int, int, int>;
+        std::map<BatchKey, std::vector<MeshRendererComponent *>> groups;
+        for (auto entity : world->getEntities())
+        {
+            if (!entity->isStatic)
+                continue;
+            auto meshRenderer = entity->getComponent<MeshRendererComponent>();
+            if (!meshRenderer || !meshRenderer->mesh || !meshRenderer->material)
+                continue;
+            glm::vec3 center = glm::vec3(entity->localTransform.toMat4() * glm::vec4(meshRenderer->mesh->getBoundsCenter(), 1.0f));
+            glm::ivec3 cell = glm::ivec3(glm::floor(center / cellSize));
+            groups[{entity->parent, meshRenderer->material, cell.x, cell.y, cell.z}].push_back(meshRenderer);
+        }
+
+        // The data of every source mesh is read back only once even if it is used by many entities
+        std::map<Mesh *, std::pair<std::vector<Vertex>, std::vector<unsigned int>>> meshData;
+
+        size_t created = 0;
+        for (auto &[key, meshRenderers] : groups)
+        {
+            // There is nothing to gain from batching a single entity
+            if (meshRenderers.size() < 2)
+                continue;
+
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> elements;
+            for (auto meshRenderer : meshRenderers)
+            {
+                auto it = meshData.find(meshRenderer->mesh);
+                if (it == meshData.end())
+                    it = meshData.emplace(meshRenderer->mesh, std::make_pair(meshRenderer->mesh->readVertices(), meshRenderer->mesh->readElements())).first;
+                const auto &[sourceVertices, sourceElements] = it->second;
+
+                // Transform the vertices from the entity space to its parent space
+                glm::mat4 M = meshRenderer->getOwner()->localTransform.toMat4();
+                glm::mat3 M_IT = glm::transpose(glm::inverse(glm::mat3(M)));
+                unsigned int baseVertex = vertices.size();
+                for (Vertex vertex : sourceVertices)
+                {
+                    vertex.position = glm::vec3(M * glm::vec4(vertex.position, 1.0f));
+                    vertex.normal = glm::normalize(M_IT * vertex.normal);
+                    vertices.push_back(vertex);
+                }
+                for (unsigned int element : sourceElements)
+                    elements.push_back(baseVertex + element);
+            }
+
+            // The batch mesh is owned by the asset loader and drawn by a new entity in place of the merged ones
+            Mesh *mesh = new Mesh(vertices, elements);
+            AssetLoader<Mesh>::add("__static_batch_" + std::to_string(batchCount++), mesh);
+
+            Entity *batchEntity = world->add();
+            batchEntity->name = "static batch";
+            batchEntity->parent = std::get<0>(key);
+            batchEntity->isStatic = true;
+            auto batchRenderer = batchEntity->addComponent<MeshRendererComponent>();
+            batchRenderer->mesh = mesh;
+            batchRenderer->material = std::get<1>(key);
+
+            for (auto meshRenderer : meshRenderers)
+                meshRenderer->getOwner()->deleteComponent(meshRenderer);
+            created++;
+        }
+        return created;
+    }
+
+}
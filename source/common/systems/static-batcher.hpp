@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+#include "../components/mesh-renderer.hpp"
+
+#include <json/json.hpp>
+
+namespace our
+{
+
+    // The static batcher merges the meshes of static entities (entities marked with "static": true) into a few big meshes
+    // Entities are merged if they share the same parent and the same material, so each batch can be attached to that parent
+    // (which may still move, e.g. the rails follow the camera) and drawn with a single draw call.
+    // The vertices are pre-transformed to the parent space, and the batches are split into cubic cells (in the parent space)
+    // so that the frustum culling can still reject the parts of the batch that are not visible.
+    // Anything that is not static (or is the only member of its batch) is left untouched and drawn individually.
+    class StaticBatcher
+    {
+        // If false, "batch" does nothing and every entity is drawn individually
+        bool enabled = true;
+        // The size of the cells into which the batches are split
+        float cellSize = 8.0f;
+        // The number of batches created so far (used to give every batch mesh a unique name)
+        size_t batchCount = 0;
+
+    public:
+        // Reads the batcher options from the renderer configuration
+        void deserialize(const nlohmann::json &config)
+        {
+            if (!config.is_object())
+                return;
+            enabled = config.value("staticBatching", enabled);
+            cellSize = config.value("staticBatchCellSize", cellSize);
+        }
+
+        // Merges the static entities of the world into batches
+        // This should be called once after the world is deserialized (and after the assets are loaded)
+        // The batch meshes are owned by the "AssetLoader<Mesh>" so they are deleted with the other assets
+        // Returns the number of batches that were created
+        size_t batch(World *world);
+    };
+
+}
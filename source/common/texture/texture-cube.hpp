@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/gl.h>
+
+namespace our
+{
+
+    // This class defines an OpenGL texture which will be used as a GL_TEXTURE_CUBE_MAP
+    class TextureCube
+    {
+        // The OpenGL object name of this texture
+        GLuint name = 0;
+        // The bytes of video memory used by the storage of this texture (see "setMemoryUsage")
+        size_t memoryUsage = 0;
+
+    public:
+        // The bytes of video memory used by the storage of all the cubemaps (see "PerformanceHud")
+        inline static size_t totalMemoryUsage = 0;
+
+        // This constructor creates an OpenGL texture and saves its object name in the member variable "name"
+        TextureCube()
+        {
+            glGenTextures(1, &name);
+        };
+
+        // This deconstructor deletes the underlying OpenGL texture
+        ~TextureCube()
+        {
+            glDeleteTextures(1, &name);
+            totalMemoryUsage -= memoryUsage;
+        }
+
+        // Records how many bytes of video memory the storage of this texture uses (called by whoever allocates it, see "texture_utils")
+        void setMemoryUsage(size_t bytes)
+        {
+            totalMemoryUsage = totalMemoryUsage - memoryUsage + bytes;
+            memoryUsage = bytes;
+        }
+
+        // Get the internal OpenGL name of the texture
+        GLuint getOpenGLName()
+        {
+            return name;
+        }
+
+        // This method binds this texture to GL_TEXTURE_CUBE_MAP
+        void bind() const
+        {
+            glBindTexture(GL_TEXTURE_CUBE_MAP, name);
+        }
+
+        // This static method ensures that no texture is bound to GL_TEXTURE_CUBE_MAP
+        static void unbind()
+        {
+            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        }
+
+        TextureCube(const TextureCube &) = delete;
+        TextureCube &operator=(const TextureCube &) = delete;
+    };
+
+}
@@ -3,14 +3,29 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
+#include <glm/gtc/constants.hpp>
 #include <iostream>
 
+size_t our::texture_utils::getTexelSize(GLenum format)
+{
+    switch (format)
+    {
+    case GL_R8: return 1;
+    case GL_R16F: return 2;
+    case GL_RGB8: return 3;
+    case GL_RGBA16F: return 8;
+    case GL_RGBA32F: return 16;
+    default: return 4;
+    }
+}
+
 our::Texture2D *our::texture_utils::empty(GLenum format, glm::ivec2 size)
 {
     our::Texture2D *texture = new our::Texture2D();
     // TODO: (Req 11) Finish this function to create an empty texture with the given size and format
     texture->bind();    // binding the newly created texture using bind() funtion created in req5
     glTexStorage2D(GL_TEXTURE_2D, 1, format, size.x, size.y); // Allocate texture storage without initializing its contents
+    texture->setMemoryUsage((size_t)size.x * size.y * getTexelSize(format));
     // parametes:
     //  GL_TEXTURE_2D: Target texture
     //  1: Number of mipmap levels
@@ -58,8 +73,92 @@ our::Texture2D *our::texture_utils::loadImage(const std::string &filename, bool
     // (void *)pixel--> a pointer to the image data in memory. This is the actual pixel data of the texture.
     if (generate_mipmap)
         glGenerateMipmap(GL_TEXTURE_2D);
+    // The mip maps add a third to the size of the image
+    size_t bytes = (size_t)size.x * size.y * 4;
+    texture->setMemoryUsage(generate_mipmap ? bytes * 4 / 3 : bytes);
     // a mip level is a smaller version of the texture that's averaged in fewer pixels.
     // used when the whole details are not needed
     stbi_image_free(pixels); // Free image data after uploading to GPU
     return texture;
-}
\ No newline at end of file
+}
+
+std::vector<our::texture_utils::Pixel> our::texture_utils::loadPixels(const std::string &filename, glm::ivec2 &size)
+{
+    int channels;
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char *pixels = stbi_load(filename.c_str(), &size.x, &size.y, &channels, 4);
+    if (pixels == nullptr)
+    {
+        std::cerr << "Failed to load image: " << filename << std::endl;
+        return {};
+    }
+    const Pixel *begin = reinterpret_cast<const Pixel *>(pixels);
+    std::vector<Pixel> result(begin, begin + (size_t)size.x * size.y);
+    stbi_image_free(pixels);
+    return result;
+}
+
+our::texture_utils::CubemapFaces our::texture_utils::equirectangularToCubemap(const std::vector<Pixel> &pixels, glm::ivec2 size, int faceSize)
+{
+    CubemapFaces cubemap;
+    cubemap.size = faceSize;
+    // Bilinear sampling of the image which wraps around horizontally and is clamped vertically
+    auto sample = [&](glm::vec2 uv)
+    {
+        glm::vec2 texel = uv * glm::vec2(size) - 0.5f;
+        glm::ivec2 base = glm::ivec2(glm::floor(texel));
+        glm::vec2 fraction = texel - glm::vec2(base);
+        glm::vec4 result(0.0f);
+        for (int dy = 0; dy <= 1; dy++)
+            for (int dx = 0; dx <= 1; dx++)
+            {
+                int x = ((base.x + dx) % size.x + size.x) % size.x;
+                int y = glm::clamp(base.y + dy, 0, size.y - 1);
+                float weight = (dx ? fraction.x : 1.0f - fraction.x) * (dy ? fraction.y : 1.0f - fraction.y);
+                result += glm::vec4(pixels[(size_t)y * size.x + x]) * weight;
+            }
+        return Pixel(glm::clamp(result + 0.5f, 0.0f, 255.0f));
+    };
+
+    for (int face = 0; face < 6; face++)
+    {
+        std::vector<Pixel> &facePixels = cubemap.faces[face];
+        facePixels.resize((size_t)faceSize * faceSize);
+        for (int y = 0; y < faceSize; y++)
+            for (int x = 0; x < faceSize; x++)
+            {
+                // The direction of the texel center follows the cubemap face layout of the OpenGL specification
+                float s = 2.0f * (x + 0.5f) / faceSize - 1.0f, t = 2.0f * (y + 0.5f) / faceSize - 1.0f;
+                glm::vec3 direction;
+                switch (face)
+                {
+                case 0: direction = {1.0f, -t, -s}; break;
+                case 1: direction = {-1.0f, -t, s}; break;
+                case 2: direction = {s, 1.0f, t}; break;
+                case 3: direction = {s, -1.0f, -t}; break;
+                case 4: direction = {s, -t, 1.0f}; break;
+                default: direction = {-s, -t, -1.0f}; break;
+                }
+                direction = glm::normalize(direction);
+                // The inverse of the sphere mapping: yaw = u * 2pi and pitch = v * pi - pi/2
+                float yaw = std::atan2(direction.z, direction.x);
+                if (yaw < 0.0f)
+                    yaw += glm::two_pi<float>();
+                float pitch = std::asin(glm::clamp(direction.y, -1.0f, 1.0f));
+                facePixels[(size_t)y * faceSize + x] = sample({yaw / glm::two_pi<float>(), pitch / glm::pi<float>() + 0.5f});
+            }
+    }
+    return cubemap;
+}
+
+our::TextureCube *our::texture_utils::cubemap(const CubemapFaces &faces)
+{
+    our::TextureCube *texture = new our::TextureCube();
+    texture->bind();
+    for (int face = 0; face < 6; face++)
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGBA8, faces.size, faces.size, 0, GL_RGBA, GL_UNSIGNED_BYTE, faces.faces[face].data());
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    // 6 RGBA8 faces and a third more for their mip maps
+    texture->setMemoryUsage(6 * (size_t)faces.size * faces.size * 4 * 4 / 3);
+    return texture;
+}
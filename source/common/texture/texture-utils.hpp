@@ -1,14 +1,38 @@
 #pragma once
 
 #include "texture2d.hpp"
+#include "texture-cube.hpp"
 #include <string>
+#include <vector>
 
 #include <glad/gl.h>
-#include <glm/vec2.hpp>
+#include <glm/glm.hpp>
 
 namespace our::texture_utils {
+    // An RGBA8 pixel
+    typedef glm::vec<4, glm::uint8, glm::defaultp> Pixel;
+
+    // The pixels of the 6 faces of a cubemap (in the order of GL_TEXTURE_CUBE_MAP_POSITIVE_X + face),
+    // every face is "size" * "size" RGBA8 pixels starting with the row where t = 0
+    struct CubemapFaces {
+        int size = 0;
+        std::vector<Pixel> faces[6];
+    };
+
+    // Returns the size in bytes of a texel of the given internal format (4 bytes for the formats the engine does not use)
+    size_t getTexelSize(GLenum format);
+
     // This function create an empty texture with a specific format (useful for framebuffers)
     Texture2D* empty(GLenum format, glm::ivec2 size);
     // This function loads an image and sends its data to the given Texture2D 
     Texture2D* loadImage(const std::string& filename, bool generate_mipmap = true);
+    // This function loads the RGBA8 pixels of an image (bottom row first, like "loadImage") without creating a texture
+    // It returns an empty vector if the image could not be loaded
+    std::vector<Pixel> loadPixels(const std::string& filename, glm::ivec2& size);
+    // This function resamples an equirectangular (latitude-longitude) image into the faces of a cubemap
+    // The image is mapped like a texture on "mesh_utils::sphere" so that the sky looks the same when drawn either way
+    // It makes no OpenGL call, so it can run on a worker thread
+    CubemapFaces equirectangularToCubemap(const std::vector<Pixel>& pixels, glm::ivec2 size, int faceSize);
+    // This function uploads the faces into a new cubemap texture (with mipmaps)
+    TextureCube* cubemap(const CubemapFaces& faces);
 }
\ No newline at end of file
@@ -10,8 +10,15 @@ namespace our
     {
         // The OpenGL object name of this texture
         GLuint name = 0;
+        // The bytes of video memory used by the storage of this texture (see "setMemoryUsage")
+        size_t memoryUsage = 0;
 
     public:
+        // The number of times any texture was bound since it was last reset (see "PerformanceHud")
+        inline static size_t bindCount = 0;
+        // The bytes of video memory used by the storage of all the textures (see "PerformanceHud")
+        inline static size_t totalMemoryUsage = 0;
+
         // This constructor creates an OpenGL texture and saves its object name in the member variable "name"
         Texture2D()
         {
@@ -24,6 +31,14 @@ namespace our
         {
             // TODO: (Req 5) Complete this function
             glDeleteTextures(1, &name); // deletes one texture that's saved it in the member variable "name"
+            totalMemoryUsage -= memoryUsage;
+        }
+
+        // Records how many bytes of video memory the storage of this texture uses (called by whoever allocates it, see "texture_utils")
+        void setMemoryUsage(size_t bytes)
+        {
+            totalMemoryUsage = totalMemoryUsage - memoryUsage + bytes;
+            memoryUsage = bytes;
         }
 
         // Get the internal OpenGL name of the texture which is useful for use with framebuffers
@@ -37,6 +52,7 @@ namespace our
         {
             // TODO: (Req 5) Complete this function
             glBindTexture(GL_TEXTURE_2D, name); // bind the texture "name" that we generated in the constructor to GL_TEXTURE_2D
+            bindCount++;
         }
 
         // This static method ensures that no texture is bound to GL_TEXTURE_2D
@@ -29,6 +29,9 @@ int main(int argc, char** argv) {
     // This is useful for testing multiple configurations in a batch
     // Default: 0 where the application runs indefinitely until manually closed
     int run_for_frames = args.get<int>("f", 0);
+    // trace_path is the file to which the CPU trace is written when the application closes
+    // Default: "" where the trace is only written when F9 is pressed (if "cpuTracer" is enabled in the config)
+    std::string trace_path = args.get<std::string>("t", "");
 
     // Open the config file and exit if failed
     std::ifstream file_in(config_path);
@@ -39,6 +42,8 @@ int main(int argc, char** argv) {
     // Read the file into a json object then close the file
     nlohmann::json app_config = nlohmann::json::parse(file_in, nullptr, true, true);
     file_in.close();
+    // A trace requested from the command line enables the tracer
+    if(!trace_path.empty()) app_config["cpuTracer"]["output"] = trace_path;
 
     // Create the application
     our::Application app(app_config);
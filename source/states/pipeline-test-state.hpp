@@ -77,6 +77,7 @@ class PipelineTestState: public our::State {
         // to make sure that glClear works correctly
         glColorMask(true, true, true, true);
         glDepthMask(true);
+        our::PipelineState::invalidateCache();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         shader->use();
         // Before drawing, we setup the pipeline state
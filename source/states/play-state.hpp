@@ -3,7 +3,7 @@
 #include <application.hpp>
 
 #include <ecs/world.hpp>
-#include <systems/forward-renderer.hpp>
+#include <systems/deferred-renderer.hpp>
 #include <systems/free-camera-controller.hpp>
 #include <systems/free-player-controller.hpp>
 #include <systems/repeat-controller.hpp>
@@ -11,18 +11,25 @@
 #include <systems/movement.hpp>
 #include <asset-loader.hpp>
 #include<systems/collision.hpp>
+#include <systems/static-batcher.hpp>
+#include <systems/light-baker.hpp>
+#include <systems/performance-hud.hpp>
+#include <systems/cpu-tracer.hpp>
 #include <imgui.h>
 
 // This state shows how to use the ECS framework and deserialization.
 class Playstate: public our::State {
 
     our::World world;
-    our::ForwardRenderer renderer;
+    // The renderer type is picked by the renderer configuration (see "our::createRenderer")
+    our::ForwardRenderer *renderer = nullptr;
     our::FreeCameraControllerSystem cameraController;
     our::FreePLayerControllerSystem playerController;
     our::RepeatControllerSystem repeatController;
     our::CollisionSystem collisionController;
     our::MovementSystem movementSystem;
+    our::StaticBatcher staticBatcher;
+    our::LightBaker lightBaker;
 
     our::Entity *player;
     our::Entity *inspector;
@@ -51,8 +58,21 @@ class Playstate: public our::State {
         }
         // If we have a world in the scene config, we use it to populate our world
         if(config.contains("world")){
+            TRACE_SCOPE("Deserialize world");
             world.deserialize(config["world"]);
         }
+        // Merge the static entities into a few batches (unless it is disabled in the renderer configuration)
+        {
+            TRACE_SCOPE("Static batching");
+            staticBatcher.deserialize(config["renderer"]);
+            staticBatcher.batch(&world);
+        }
+        // Bake the static lights into the static meshes (after batching so that the batches are baked instead of their parts)
+        {
+            TRACE_SCOPE("Light baking");
+            lightBaker.deserialize(config["renderer"]);
+            lightBaker.bake(&world);
+        }
         // We initialize the camera controller system since it needs a pointer to the app
         player = world.getEntityByName("magdy");
         inspector = world.getEntityByName("dog");
@@ -69,7 +89,13 @@ class Playstate: public our::State {
         // Then we initialize the renderer
         collisionController.setPlayer(player);
         auto size = getApp()->getFrameBufferSize();
-        renderer.initialize(size, config["renderer"],player);
+        {
+            TRACE_SCOPE("Initialize renderer");
+            renderer = our::createRenderer(config["renderer"]);
+            renderer->initialize(size, config["renderer"],player);
+        }
+        // The performance HUD counts the entities and components of this world
+        our::PerformanceHud::setWorld(&world);
     }
 
     void onImmediateGui() override
@@ -104,6 +130,10 @@ class Playstate: public our::State {
 
         ImGui::PopStyleVar(3);  // Pop the style variables
         ImGui::PopStyleColor(); // Pop the style color
+
+        // Show what the quality governor measured and picked (if it is enabled in the renderer config)
+        if (renderer->getQualityGovernor().isOverlayEnabled())
+            renderer->getQualityGovernor().drawOverlay();
     }
 
     void drawHearts(){
@@ -132,9 +162,19 @@ class Playstate: public our::State {
     }
     void onDraw(double deltaTime) override {
         // Here, we just run a bunch of systems to control the world logic
-        movementSystem.update(&world, (float)deltaTime);
-        cameraController.update(&world, (float)deltaTime);
-        playerController.update(&world, (float)deltaTime);
+        // (each one is recorded in the CPU trace and timed by the performance HUD while it is visible)
+        {
+            TRACE_SYSTEM("Movement");
+            movementSystem.update(&world, (float)deltaTime);
+        }
+        {
+            TRACE_SYSTEM("Camera controller");
+            cameraController.update(&world, (float)deltaTime);
+        }
+        {
+            TRACE_SYSTEM("Player controller");
+            playerController.update(&world, (float)deltaTime);
+        }
 
         // collisionController.update(&world, (float)deltaTime) function check the world entities and 
         // check if there is a collision between them and between the player so it take the 
@@ -151,7 +191,11 @@ class Playstate: public our::State {
         // 3                      taek a heart                    - increase hearts by one 
 
 
-        int collider = collisionController.update(&world, (float)deltaTime);
+        int collider;
+        {
+            TRACE_SYSTEM("Collision");
+            collider = collisionController.update(&world, (float)deltaTime);
+        }
         if(collider==1){
             score= score+10;
         }else if(collider==-1){
@@ -179,9 +223,11 @@ class Playstate: public our::State {
         }
 
         
-        collisionController.UpdatePlayerHight(&world);
-        // get current time
-        repeatController.update(&world);
+        {
+            TRACE_SYSTEM("Repeat controller");
+            collisionController.UpdatePlayerHight(&world);
+            repeatController.update(&world);
+        }
 
 
         if(increaseSpeedEffect && glfwGetTime() - time > 2.0){
@@ -204,7 +250,10 @@ class Playstate: public our::State {
         }
 
         // And finally we use the renderer system to draw the scene
-        renderer.render(&world, increaseSpeedEffect, collisionEffect);
+        {
+            TRACE_SYSTEM("Renderer");
+            renderer->render(&world, increaseSpeedEffect, collisionEffect);
+        }
 
         // Get a reference to the keyboard object
         auto &keyboard = getApp()->getKeyboard();
@@ -217,12 +266,15 @@ class Playstate: public our::State {
 
     void onDestroy() override {
         // Don't forget to destroy the renderer
-        renderer.destroy();
+        renderer->destroy();
+        delete renderer;
+        renderer = nullptr;
         // On exit, we call exit for the camera controller system to make sure that the mouse is unlocked
         cameraController.exit();
         playerController.exit();
         repeatController.exit();
-        // Clear the world
+        // Clear the world (after the performance HUD stops counting it)
+        our::PerformanceHud::setWorld(nullptr);
         world.clear();
         // and we delete all the loaded assets to free memory on the RAM and the VRAM
         our::clearAllAssets();
@@ -4,14 +4,16 @@
 #include <ecs/world.hpp>
 #include <components/camera.hpp>
 #include <components/mesh-renderer.hpp>
-#include <systems/forward-renderer.hpp>
+#include <systems/deferred-renderer.hpp>
+#include <systems/light-baker.hpp>
 #include <application.hpp>
 
 // This state tests and shows how to use the Forward renderer.
 class RendererTestState: public our::State {
 
     our::World world;
-    our::ForwardRenderer renderer;
+    our::ForwardRenderer *renderer = nullptr;
+    our::LightBaker lightBaker;
     
     void onInitialize() override {
         // First of all, we get the scene configuration from the app config
@@ -25,17 +27,24 @@ class RendererTestState: public our::State {
         if(config.contains("world")){
             world.deserialize(config["world"]);
         }
+        // The lights marked with "bake" are baked into the static meshes like in the play state
+        lightBaker.deserialize(config["renderer"]);
+        lightBaker.bake(&world);
 
         glm::ivec2 size = getApp()->getFrameBufferSize();
-        renderer.initialize(size, config["renderer"]);
+        renderer = our::createRenderer(config["renderer"]);
+        renderer->initialize(size, config["renderer"]);
     }
 
     void onDraw(double deltaTime) override {
         // We simply call the renderer's "render" function and it should do all the rendering work
-        renderer.render(&world);
+        renderer->render(&world);
     }
 
     void onDestroy() override {
+        renderer->destroy();
+        delete renderer;
+        renderer = nullptr;
         world.clear();
         our::clearAllAssets();
     }